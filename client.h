@@ -0,0 +1,272 @@
+#ifndef __CLIENT_H__
+#define __CLIENT_H__
+
+#pragma once
+
+
+#include "config.h"
+#include "connection.h"
+#include "cpulist.h"
+#include "debug_util.h"
+#include "filter.h"
+#include "mapping.h"
+#include "platform.h"
+#include "string_util.h"
+#include "tetris.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+
+
+/***
+ * Global variables (defined by the program using the manager)
+ ***/
+
+extern debug::LoggerPtr logger;
+extern PlatformPtr platform;
+
+using ConnectionPtr = std::shared_ptr<Connection>;
+using Clock = Platform::Clock;
+
+
+/***
+ * Client Program
+ ***/
+
+class Client
+{
+   public:
+    struct Thread
+    {
+        std::string     name;
+        int             tid;
+        CPUList         cpus;
+
+        Thread(const std::string& name, int tid, CPUList cpus) :
+            name{name}, tid{tid}, cpus{cpus}
+        {}
+    };
+
+    class Comp
+    {
+       private:
+        std::string     _criteria;
+        bool            _more_is_better;
+        std::function<bool(const double, const double)> _comp;
+
+       public:
+        Comp(const std::string compare_criteria, bool compare_more_is_better) :
+            _criteria{compare_criteria}, _more_is_better{compare_more_is_better}
+        {
+            if (_more_is_better)
+                _comp = std::greater<double>{};
+            else
+                _comp = std::less<double>{};
+        }
+
+        Comp() :
+            _criteria{}, _comp{std::less<double>()}
+        {}
+
+        bool operator()(const Mapping& other, const Mapping& best)
+        {
+            return _comp(other.characteristic(_criteria), best.characteristic(_criteria));
+        }
+
+        std::string criteria() const
+        {
+            return _criteria;
+        }
+
+        bool more_is_better() const
+        {
+            return _more_is_better;
+        }
+
+        /* How much worse the mapping is compared to the reference value, relative to the
+         * reference value. Negative values mean that the mapping is better. */
+        double degradation(const Mapping& m, double reference) const
+        {
+            if (reference == 0)
+                return 0;
+
+            double value = m.characteristic(_criteria);
+
+            return (_more_is_better ? reference - value : value - reference) / std::abs(reference);
+        }
+
+        std::string repr() const
+        {
+            std::stringstream ss;
+            ss << _criteria << "(" << (_more_is_better ? ">" : "<") << ")";
+
+            return ss.str();
+        }
+    };
+
+    enum class State
+    {
+        NEW,        /* Connected, but not yet registered */
+        RUNNING,    /* Running on its own mapping */
+        WAITING,    /* Waiting in the admission queue on the leftover cpus */
+        SUSPENDED,  /* Waiting in the admission queue stopped and not yet acknowledged */
+        SLICED,     /* Sharing its cpus with other clients in rotating time slots */
+        PENDING     /* Waiting for the placement of the batch it arrived in, not yet acknowledged */
+    };
+
+   public:
+    int                     id;
+    ConnectionPtr           connection;
+    std::string             exec;
+    int                     pid;
+    bool                    dynamic_client;
+    std::vector<Thread>     threads;
+    std::vector<Mapping>    mappings;
+    Mapping                 active_mapping;
+
+    Filter                  filter;
+    Comp                    comp;
+
+    State                   state;
+    TetrisData::Admission   admission;
+    Clock::time_point       waiting_since;
+
+    int                     priority;
+    double                  max_degradation;
+    double                  reference;
+
+    bool                    exclusive;
+
+    /* The user and cgroup the client runs as, uid -1 if unknown. */
+    int                     uid;
+    std::string             user;
+    std::string             cgroup;
+
+    /* Clients of the same group are placed together. */
+    std::string             group;
+    int                     group_size;
+
+    bool                    refine;
+
+    unsigned long           upgrades;
+    Clock::time_point       last_upgrade;
+
+    double                  best_value;
+
+    /* The time slot of the client, running clients belong to slot 0. */
+    int                     slot;
+    bool                    stopped;
+
+    /* The mapping whose runtime is observed for exploration, empty if the run doesn't count. */
+    std::string             run_mapping;
+    double                  run_predicted;
+    Clock::time_point       run_start;
+
+    /* The programs which ran on the same clusters during the run, and the slowdown expected
+     * from those next to the client when it got its mapping. */
+    std::set<std::string>   run_neighbours;
+    double                  slowdown;
+
+   public:
+    Client(const Client&) = delete;
+
+    Client(int id, const ConnectionPtr& conn) :
+        id{id}, connection{conn}, exec{}, pid{-1}, dynamic_client{false}, threads{}, mappings{}, active_mapping{},
+        filter{}, comp{}, state{State::NEW}, admission{TetrisData::Admission::DEFAULT}, waiting_since{},
+        priority{0}, max_degradation{0}, reference{0}, exclusive{false}, uid{-1}, user{}, cgroup{}, group{},
+        group_size{0}, refine{false}, upgrades{0}, last_upgrade{}, best_value{0}, slot{0}, stopped{false},
+        run_mapping{}, run_predicted{0}, run_start{}, run_neighbours{}, slowdown{1}
+    {}
+
+    ~Client()
+    {
+        if (pid != -1)
+            logger->info("Client removed '%s' [%d]\n", exec.c_str(), pid);
+    }
+
+    CPUList cpus() const
+    {
+        return active_mapping.cpus;
+    }
+
+    void update_mapping(const Mapping& new_mapping)
+    {
+        /* Equivalent mappings share the name, but not the CPUs. */
+        if (new_mapping.name == active_mapping.name && new_mapping.cpus == active_mapping.cpus &&
+                new_mapping.thread_map == active_mapping.thread_map)
+            return;
+
+        logger->info("Change mapping for client '%s' [%i] to %s\n", exec.c_str(), pid, new_mapping.name.c_str());
+        active_mapping = new_mapping;
+
+        for (auto& t : threads) {
+            CPUList cpus;
+            if (dynamic_client)
+                cpus = active_mapping.cpus;
+            else
+                cpus = active_mapping.cpu(t.name);
+
+            logger->info(" * remap thread '%s' [%i] from cpu(s) %s to cpu(s) %s\n", t.name.c_str(), t.tid,
+                    string_util::join(t.cpus.cpulist(num_cpus), ",").c_str(),
+                    string_util::join(cpus.cpulist(num_cpus), ",").c_str());
+
+            t.cpus = cpus;
+
+            if (!platform->set_affinity(t.tid, cpus))
+                logger->warning("Failed to set cpu affinity for thread '%s': %s\n", t.name.c_str(), strerror(errno));
+        }
+    }
+
+    void new_thread(const std::string& name, int tid)
+    {
+        logger->info("New thread '%s' [%i] registered for client '%s' [%d]\n", name.c_str(), tid, exec.c_str(), pid);
+
+        CPUList cpus;
+        if (dynamic_client) {
+            cpus = active_mapping.cpus;
+            logger->info(" * enabled cpu(s) %s (dynamic client)\n", string_util::join(cpus.cpulist(num_cpus), ",").c_str());
+        } else {
+            cpus = active_mapping.cpu(name);
+            logger->info(" * enabled cpu(s) %s\n", string_util::join(cpus.cpulist(num_cpus), ",").c_str());
+        }
+
+        auto it = std::find_if(threads.begin(), threads.end(), [&](const auto& t) { return t.name == name; });
+        if (it == threads.end()) {
+            threads.emplace_back(name, tid, cpus);
+
+            if (!platform->set_affinity(tid, cpus))
+                logger->warning("Failed to set cpu affinity for thread '%s': %s\n", name.c_str(), strerror(errno));
+        } else
+            logger->warning("Duplicate thread '%s'\n", name.c_str());
+    }
+
+    void restrict_tasks()
+    {
+        /* Confine all tasks of the process which are not registered yet to the mapping's
+         * cpus, so that no thread leaves them when the process continues. */
+        auto tasks = platform->tasks(pid);
+        if (tasks.empty()) {
+            logger->warning("Failed to list tasks of client '%s' [%d]\n", exec.c_str(), pid);
+            return;
+        }
+
+        for (auto tid : tasks) {
+            if (std::find_if(threads.begin(), threads.end(), [&](const auto& t) { return t.tid == tid; }) != threads.end())
+                continue;
+
+            if (!platform->set_affinity(tid, active_mapping.cpus))
+                logger->warning("Failed to set cpu affinity for task %i: %s\n", tid, strerror(errno));
+        }
+    }
+};
+
+#endif /* __CLIENT_H__ */
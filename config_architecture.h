@@ -4,8 +4,11 @@
 #pragma once
 
 
+#include "cpulist.h"
+
 #include <map>
 #include <string>
+#include <vector>
 
 
 static
@@ -23,4 +26,17 @@ std::map<std::string, int> cpu_map =
 
 const static int num_cpus = 8;
 
+struct Cluster
+{
+    std::string     name;
+    CPUList         cpus;
+};
+
+static
+std::vector<Cluster> clusters =
+{
+    {"little",  {0, 1, 2, 3}},
+    {"big",     {4, 5, 6, 7}}
+};
+
 #endif /* __CONFIG_ARCHITECTURE_H__ */
@@ -6,6 +6,7 @@
 
 #include <memory>
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
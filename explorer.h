@@ -0,0 +1,197 @@
+#ifndef __EXPLORER_H__
+#define __EXPLORER_H__
+
+#pragma once
+
+
+#include "string_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+/* Learns which mapping of a program actually runs fastest from the runtimes observed when
+ * it ran before. Every mapping of a program is an arm of a bandit. The characteristic of
+ * the mapping, scaled to the observed runtimes of the program, is the prior of an arm and
+ * the observations refine it (normal model). Exploring runs pick the arm with the best
+ * sample of the posteriors (Thompson sampling), the others the best posterior mean. */
+class Explorer
+{
+   public:
+    struct Arm
+    {
+        unsigned long   runs = 0;
+        double          mean = 0;       /* Observed runtime in s */
+        double          m2 = 0;         /* Sum of squared deviations from the mean */
+        double          predicted = 0;  /* The characteristic of the mapping */
+
+        double variance() const
+        {
+            return runs > 1 ? m2 / (runs - 1) : 0;
+        }
+    };
+
+   private:
+    /* Standard deviation of the prior and minimum one of the observations, relative to the mean. */
+    constexpr static double PRIOR_SPREAD = 0.25;
+    constexpr static double MIN_NOISE = 0.05;
+
+    std::map<std::string, std::map<std::string, Arm>> _arms;
+    std::mt19937        _rng;
+
+    /* Observed runtime per unit of the characteristic, 1 without any observation. */
+    double scale(const std::string& exec) const
+    {
+        auto it = _arms.find(exec);
+        if (it == _arms.end())
+            return 1;
+
+        double observed = 0, predicted = 0;
+        for (const auto& [name, arm] : it->second) {
+            observed += arm.runs * arm.mean;
+            predicted += arm.runs * arm.predicted;
+        }
+
+        return observed > 0 && predicted > 0 ? observed / predicted : 1;
+    }
+
+   public:
+    explicit Explorer(unsigned seed) :
+        _arms{}, _rng{seed}
+    {}
+
+    const Arm* arm(const std::string& exec, const std::string& mapping) const
+    {
+        auto it = _arms.find(exec);
+        if (it == _arms.end())
+            return nullptr;
+
+        auto a = it->second.find(mapping);
+        return a != it->second.end() ? &a->second : nullptr;
+    }
+
+    const std::map<std::string, std::map<std::string, Arm>>& programs() const
+    {
+        return _arms;
+    }
+
+    void record(const std::string& exec, const std::string& mapping, double predicted, double runtime)
+    {
+        auto& a = _arms[exec][mapping];
+
+        ++a.runs;
+        double delta = runtime - a.mean;
+        a.mean += delta / a.runs;
+        a.m2 += delta * (runtime - a.mean);
+        a.predicted = predicted;
+    }
+
+    /* Mean and variance of the expected runtime of a mapping with the given characteristic. */
+    std::pair<double, double> posterior(const std::string& exec, const std::string& mapping, double predicted) const
+    {
+        double m0 = scale(exec) * predicted;
+        double v0 = std::pow(PRIOR_SPREAD * m0, 2);
+
+        auto a = arm(exec, mapping);
+        if (a == nullptr || a->runs == 0 || v0 <= 0)
+            return {m0, v0};
+
+        double noise = std::max(a->variance(), std::pow(MIN_NOISE * a->mean, 2));
+        if (noise <= 0)
+            return {a->mean, 0};
+
+        double precision = 1 / v0 + a->runs / noise;
+        return {(m0 / v0 + a->runs * a->mean / noise) / precision, 1 / precision};
+    }
+
+    /* The index of the mapping expected to run fastest, or the one with the fastest sample
+     * of its posterior if sample is set. */
+    int choose(const std::string& exec, const std::vector<std::string>& mappings, const std::vector<double>& predicted,
+            bool sample)
+    {
+        int best = -1;
+        double best_value = std::numeric_limits<double>::infinity();
+
+        for (size_t i = 0; i < mappings.size(); ++i) {
+            auto [mean, variance] = posterior(exec, mappings[i], predicted[i]);
+
+            double value = mean;
+            if (sample && variance > 0)
+                value = std::normal_distribution<double>{mean, std::sqrt(variance)}(_rng);
+
+            if (value < best_value) {
+                best = static_cast<int>(i);
+                best_value = value;
+            }
+        }
+
+        return best;
+    }
+
+    bool draw(double probability)
+    {
+        return std::uniform_real_distribution<double>{0, 1}(_rng) < probability;
+    }
+
+    /* The state is kept as tab separated lines: exec, mapping, runs, mean, m2, predicted. */
+    void load(const std::string& path)
+    {
+        std::ifstream in{path};
+        if (!in.is_open())
+            return;
+
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            auto fields = string_util::split(line, '\t');
+            if (fields.size() != 6)
+                throw std::runtime_error{"Malformed exploration state in " + path + ": " + line};
+
+            Arm a;
+            try {
+                a.runs = std::stoul(fields[2]);
+                a.mean = std::stod(fields[3]);
+                a.m2 = std::stod(fields[4]);
+                a.predicted = std::stod(fields[5]);
+            } catch (std::exception&) {
+                throw std::runtime_error{"Malformed exploration state in " + path + ": " + line};
+            }
+
+            _arms[fields[0]][fields[1]] = a;
+        }
+    }
+
+    /* Written to a temporary file first, so that a crash never leaves a partial state. */
+    void save(const std::string& path) const
+    {
+        auto tmp = path + ".tmp";
+        {
+            std::ofstream out{tmp, std::ios::trunc};
+            if (!out.is_open())
+                throw std::runtime_error{"Failed to write exploration state " + tmp};
+
+            out.precision(17);
+            out << "# exec\tmapping\truns\tmean\tm2\tpredicted" << std::endl;
+            for (const auto& [exec, arms] : _arms) {
+                for (const auto& [name, a] : arms)
+                    out << exec << '\t' << name << '\t' << a.runs << '\t' << a.mean << '\t' << a.m2 << '\t'
+                        << a.predicted << std::endl;
+            }
+        }
+
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error{"Failed to replace exploration state " + path};
+    }
+};
+
+#endif /* __EXPLORER_H__ */
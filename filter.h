@@ -4,268 +4,517 @@
 #pragma once
 
 
-#include "debug_util.h"
-#include "string_util.h"
 #include "mapping.h"
 
-#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 
-namespace detail {
-
-class FilterComp
+class FilterError : public std::runtime_error
 {
    public:
-    virtual ~FilterComp() = default;
+    using std::runtime_error::runtime_error;
+};
 
-    virtual bool comp(const Mapping& map) const = 0;
-    virtual FilterComp* clone() const = 0;
 
-    virtual std::string criteria() const = 0;
-    virtual std::string repr() const = 0;
+namespace detail {
+
+enum class FilterOp : uint8_t {
+    CONST,      /* push value */
+    LOAD,       /* push characteristic id */
+    ANCHOR,     /* push anchor id, the best value of a characteristic among the candidates */
+    NEG,
+    NOT,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    EQUAL,
+    NOT_EQUAL,
+    AND,
+    OR
 };
 
-template <typename BaseComp>
-class StdComp : public FilterComp
+struct FilterInstruction
+{
+    FilterOp        op;
+    int             id;
+    double          value;
+};
+
+struct FilterAnchor
+{
+    std::string     criteria;
+    int             id;
+    bool            max;
+};
+
+/* Recursive descent parser which emits the expression in postfix order.
+ *
+ *  or      := and ('||' and)*
+ *  and     := not ('&&' not)*
+ *  not     := '!' not | cmp
+ *  cmp     := sum (('<' | '<=' | '>' | '>=' | '==' | '=' | '!=') sum)?
+ *  sum     := product (('+' | '-') product)*
+ *  product := unary (('*' | '/') unary)*
+ *  unary   := '-' unary | primary
+ *  primary := number | characteristic | 'best' | ('min' | 'max') '(' characteristic ')' | '(' or ')'
+ *
+ * 'best' stands for the best value of the characteristic on the other side of the
+ * comparison: the minimum if that side should be smaller, the maximum otherwise.
+ */
+class FilterParser
 {
    private:
-    std::string     _criteria;
-    double          _value;
+    const std::string&              _text;
+    size_t                          _pos;
+    std::vector<FilterInstruction>& _code;
+    std::vector<FilterAnchor>&      _anchors;
 
-    BaseComp        _comp;
+    /* Placeholder for a 'best' which is not yet bound to a characteristic. */
+    constexpr static int UNBOUND = -1;
 
-   public:
-    StdComp(const std::string& criteria, const double value) :
-        _criteria{criteria}, _value{value}, _comp{}
-    {}
+    [[noreturn]] void fail(const std::string& what) const
+    {
+        throw FilterError{"Malformed filter '" + _text + "' at position " + std::to_string(_pos) + ": " + what};
+    }
 
-    bool comp(const Mapping& map) const
+    void skip_space()
     {
-        return _comp(map.characteristic(_criteria), _value);
+        while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos])))
+            ++_pos;
     }
 
-    FilterComp* clone() const
+    bool accept(const char* token)
     {
-        return new StdComp<BaseComp>(_criteria, _value);
+        skip_space();
+
+        size_t len = std::char_traits<char>::length(token);
+        if (_text.compare(_pos, len, token) != 0)
+            return false;
+
+        /* Don't take the prefix of a longer operator. */
+        if (len == 1 && _pos + 1 < _text.size() && _text[_pos + 1] == '=' &&
+                (token[0] == '<' || token[0] == '>' || token[0] == '!' || token[0] == '='))
+            return false;
+
+        _pos += len;
+        return true;
     }
 
-    std::string criteria() const
+    void emit(FilterOp op, int id = -1, double value = 0)
     {
-        return _criteria;
+        _code.push_back({op, id, value});
     }
 
-    std::string repr() const
+    int anchor(const std::string& criteria, bool max)
     {
-        std::stringstream ss;
+        for (size_t i = 0; i < _anchors.size(); ++i) {
+            if (_anchors[i].criteria == criteria && _anchors[i].max == max)
+                return static_cast<int>(i);
+        }
 
-        ss << _criteria << debug::CompRepr<BaseComp>::repr << _value;
-        return ss.str();
+        _anchors.push_back({criteria, CharacteristicIds::id(criteria), max});
+        return static_cast<int>(_anchors.size() - 1);
     }
-};
 
-struct NoComp : public FilterComp
-{
-    bool comp(const Mapping&) const
+    std::string identifier()
     {
-        return true;
+        skip_space();
+
+        size_t start = _pos;
+        while (_pos < _text.size() && (std::isalnum(static_cast<unsigned char>(_text[_pos])) || _text[_pos] == '_'))
+            ++_pos;
+
+        return _text.substr(start, _pos - start);
+    }
+
+    /* Bind the 'best's in [begin, end) to the first characteristic in [other_begin, other_end). */
+    void bind_best(size_t begin, size_t end, size_t other_begin, size_t other_end, bool max)
+    {
+        std::string criteria;
+        for (size_t i = other_begin; i < other_end; ++i) {
+            if (_code[i].op == FilterOp::LOAD) {
+                criteria = CharacteristicIds::name(_code[i].id);
+                break;
+            }
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            if (_code[i].op != FilterOp::ANCHOR || _code[i].id != UNBOUND)
+                continue;
+
+            if (criteria.empty())
+                fail("'best' needs a characteristic on the other side of the comparison");
+
+            _code[i].id = anchor(criteria, max);
+        }
     }
 
-    FilterComp* clone() const
+    void parse_or()
     {
-        return new NoComp;
+        parse_and();
+        while (accept("||")) {
+            parse_and();
+            emit(FilterOp::OR);
+        }
     }
 
-    std::string criteria() const
+    void parse_and()
     {
-        return "none";
+        parse_not();
+        while (accept("&&")) {
+            parse_not();
+            emit(FilterOp::AND);
+        }
     }
 
-    std::string repr() const
+    void parse_not()
     {
-        return "none";
+        if (accept("!")) {
+            parse_not();
+            emit(FilterOp::NOT);
+        } else {
+            parse_cmp();
+        }
     }
-};
 
-enum Type : int {
-    GREATER,
-    GREATER_EQUAL,
-    LESS,
-    LESS_EQUAL,
-    EQUAL,
-    NOT_EQUAL,
-    NONE,
-    ERROR
-};
+    void parse_cmp()
+    {
+        size_t left = _code.size();
+        parse_sum();
+        size_t right = _code.size();
+
+        FilterOp op;
+        if (accept("<="))
+            op = FilterOp::LESS_EQUAL;
+        else if (accept(">="))
+            op = FilterOp::GREATER_EQUAL;
+        else if (accept("=="))
+            op = FilterOp::EQUAL;
+        else if (accept("!="))
+            op = FilterOp::NOT_EQUAL;
+        else if (accept("<"))
+            op = FilterOp::LESS;
+        else if (accept(">"))
+            op = FilterOp::GREATER;
+        else if (accept("="))
+            op = FilterOp::EQUAL;
+        else
+            return;
 
-} /* namespace detail*/
+        parse_sum();
+        size_t end = _code.size();
 
+        /* A smaller left side is better for '<', so 'best' on the right is the minimum. */
+        if (op != FilterOp::EQUAL && op != FilterOp::NOT_EQUAL) {
+            bool left_max = op == FilterOp::GREATER || op == FilterOp::GREATER_EQUAL;
+            bind_best(right, end, left, right, left_max);
+            bind_best(left, right, right, end, !left_max);
+        }
 
-class Filter
-{
-   private:
-    detail::FilterComp*     _comp;
+        emit(op);
+    }
 
-    void set_comperator(detail::FilterComp* comp)
+    void parse_sum()
     {
-        if (comp == _comp)
-            return;
+        parse_product();
+        while (true) {
+            if (accept("+")) {
+                parse_product();
+                emit(FilterOp::ADD);
+            } else if (accept("-")) {
+                parse_product();
+                emit(FilterOp::SUB);
+            } else {
+                break;
+            }
+        }
+    }
 
-        if (_comp)
-            delete _comp;
+    void parse_product()
+    {
+        parse_unary();
+        while (true) {
+            if (accept("*")) {
+                parse_unary();
+                emit(FilterOp::MUL);
+            } else if (accept("/")) {
+                parse_unary();
+                emit(FilterOp::DIV);
+            } else {
+                break;
+            }
+        }
+    }
 
-        _comp = comp;
+    void parse_unary()
+    {
+        if (accept("-")) {
+            parse_unary();
+            emit(FilterOp::NEG);
+        } else {
+            parse_primary();
+        }
+    }
+
+    void parse_primary()
+    {
+        skip_space();
+        if (_pos == _text.size())
+            fail("unexpected end");
+
+        char c = _text[_pos];
+        if (accept("(")) {
+            parse_or();
+            if (!accept(")"))
+                fail("missing ')'");
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            size_t len;
+            double value;
+            try {
+                value = std::stod(_text.substr(_pos), &len);
+            } catch (std::exception&) {
+                fail("malformed number");
+            }
+
+            _pos += len;
+            emit(FilterOp::CONST, -1, value);
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            std::string name = identifier();
+
+            if (name == "best") {
+                emit(FilterOp::ANCHOR, UNBOUND);
+            } else if ((name == "min" || name == "max") && accept("(")) {
+                std::string criteria = identifier();
+                if (criteria.empty() || !accept(")"))
+                    fail("expected " + name + "(characteristic)");
+
+                emit(FilterOp::ANCHOR, anchor(criteria, name == "max"));
+            } else {
+                emit(FilterOp::LOAD, CharacteristicIds::id(name));
+            }
+        } else {
+            fail(std::string{"unexpected '"} + c + "'");
+        }
     }
 
    public:
-    Filter(const std::string& filter_criteria) :
-        _comp{nullptr}
+    FilterParser(const std::string& text, std::vector<FilterInstruction>& code, std::vector<FilterAnchor>& anchors) :
+        _text{text}, _pos{0}, _code{code}, _anchors{anchors}
+    {}
+
+    void parse()
     {
-        /* We currently support 6 comparisons:
-         *      >=
-         *      >
-         *      <=
-         *      <
-         *      == or =
-         *      !=
-         *
-         * Search for one of them in the given string */
-        detail::Type type = detail::Type::ERROR;
-        std::string criteria, value;
-
-        for (size_t i = 1; i < filter_criteria.size(); ++i) {
-            switch (filter_criteria[i-1]) {
-                case '>':
-                    criteria = filter_criteria.substr(0, i-1);
-
-                    if (filter_criteria[i] == '=') {
-                        type = detail::Type::GREATER_EQUAL;
-                        value = filter_criteria.substr(i+1);
-                    } else {
-                        type = detail::Type::GREATER;
-                        value = filter_criteria.substr(i);
-                    }
+        parse_or();
 
-                    break;
-                case '<':
-                    criteria = filter_criteria.substr(0, i-1);
+        skip_space();
+        if (_pos != _text.size())
+            fail("trailing characters");
 
-                    if (filter_criteria[i] == '=') {
-                        type = detail::Type::LESS_EQUAL;
-                        value = filter_criteria.substr(i+1);
-                    } else {
-                        type = detail::Type::LESS;
-                        value = filter_criteria.substr(i);
-                    }
+        for (const auto& i : _code) {
+            if (i.op == FilterOp::ANCHOR && i.id == UNBOUND)
+                fail("'best' can only be used in '<', '<=', '>' and '>=' comparisons");
+        }
+    }
+};
 
-                    break;
-                case '=':
-                    criteria = filter_criteria.substr(0, i-1);
-                    type = detail::Type::EQUAL;
+} /* namespace detail */
 
-                    if (filter_criteria[i] == '=') {
-                        value = filter_criteria.substr(i+1);
-                    } else {
-                        value = filter_criteria.substr(i);
-                    }
 
-                    break;
-                case '!':
-                    if (filter_criteria[i] == '=') {
-                        type = detail::Type::NOT_EQUAL;
-                        value = filter_criteria.substr(i+1);
-                        criteria = filter_criteria.substr(0, i-1);
-                    }
+/* A boolean expression over a mapping's characteristics, for example
+ * "executionTime < 2e9 && (energyConsumption / executionTime < 5 || platformSize <= 4)".
+ * The expression is compiled once into postfix code with the characteristics resolved to
+ * their ids. A mapping which lacks any of the used characteristics never passes.
+ *
+ * Relative filters like "executionTime <= best * 1.1" refer to the best values among a set
+ * of candidates. They have to be anchored to the candidates before they are evaluated. */
+class Filter
+{
+   public:
+    /* Evaluation uses a fixed-size stack. */
+    constexpr static size_t MAX_DEPTH = 32;
+
+   private:
+    std::string                             _text;
+    std::vector<detail::FilterInstruction>  _code;
 
+    std::vector<detail::FilterAnchor>       _anchors;
+    std::vector<double>                     _anchor_values;
+
+    static size_t depth(const std::vector<detail::FilterInstruction>& code)
+    {
+        size_t sp = 0, max = 0;
+        for (const auto& i : code) {
+            switch (i.op) {
+                case detail::FilterOp::CONST:
+                case detail::FilterOp::LOAD:
+                case detail::FilterOp::ANCHOR:
+                    max = std::max(max, ++sp);
+                    break;
+                case detail::FilterOp::NEG:
+                case detail::FilterOp::NOT:
                     break;
+                default:
+                    --sp;
             }
-
-            if (type != detail::Type::ERROR)
-                break;
         }
 
-        switch (type) {
-            case detail::Type::GREATER:
-                set_comperator(new detail::StdComp<std::greater<double>>(string_util::strip(criteria),
-                            std::stod(string_util::strip(value))));
-                break;
-            case detail::Type::GREATER_EQUAL:
-                set_comperator(new detail::StdComp<std::greater_equal<double>>(string_util::strip(criteria),
-                            std::stod(string_util::strip(value))));
-                break;
-            case detail::Type::LESS:
-                set_comperator(new detail::StdComp<std::less<double>>(string_util::strip(criteria),
-                            std::stod(string_util::strip(value))));
-                break;
-            case detail::Type::LESS_EQUAL:
-                set_comperator(new detail::StdComp<std::less_equal<double>>(string_util::strip(criteria),
-                            std::stod(string_util::strip(value))));
-                break;
-            case detail::Type::EQUAL:
-                set_comperator(new detail::StdComp<std::equal_to<double>>(string_util::strip(criteria),
-                            std::stod(string_util::strip(value))));
-                break;
-            case detail::Type::NOT_EQUAL:
-                set_comperator(new detail::StdComp<std::not_equal_to<double>>(string_util::strip(criteria),
-                            std::stod(string_util::strip(value))));
+        return max;
+    }
+
+   public:
+    /* Throws a FilterError if the expression is malformed. An empty expression lets
+     * all mappings pass. */
+    explicit Filter(const std::string& filter_criteria) :
+        _text{}, _code{}, _anchors{}, _anchor_values{}
+    {
+        detail::FilterParser parser{filter_criteria, _code, _anchors};
+
+        for (auto c : filter_criteria) {
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                parser.parse();
                 break;
-            default:
-                set_comperator(new detail::NoComp);
+            }
         }
+
+        if (depth(_code) > MAX_DEPTH)
+            throw FilterError{"Filter '" + filter_criteria + "' is nested too deeply"};
+
+        if (!_code.empty())
+            _text = filter_criteria;
+
+        _anchor_values.assign(_anchors.size(), std::numeric_limits<double>::quiet_NaN());
     }
 
     Filter() :
-        _comp{new detail::NoComp}
+        _text{}, _code{}, _anchors{}, _anchor_values{}
     {}
 
-    Filter(const Filter& o) :
-        _comp{o._comp->clone()}
-    {}
-
-    Filter(Filter&& o) :
-        _comp{o._comp}
+    std::string repr() const
     {
-        o._comp = nullptr;
+        return _code.empty() ? "none" : _text;
     }
 
-    ~Filter()
+    bool relative() const
     {
-        if (_comp)
-            delete _comp;
+        return !_anchors.empty();
     }
 
-    Filter& operator=(const Filter& o)
+    /* Take the best values of the relative terms from the given candidates. */
+    template <typename It>
+    void anchor(It begin, It end)
     {
-        set_comperator(o._comp->clone());
+        std::fill(_anchor_values.begin(), _anchor_values.end(), std::numeric_limits<double>::quiet_NaN());
 
-        return *this;
+        for (auto m = begin; m != end; ++m) {
+            for (size_t a = 0; a < _anchors.size(); ++a) {
+                double v = m->characteristic(_anchors[a].id);
+                double& cur = _anchor_values[a];
+
+                if (std::isnan(cur) || (_anchors[a].max ? v > cur : v < cur))
+                    cur = v;
+            }
+        }
     }
 
-    Filter& operator=(Filter&& o)
+    std::string anchors_repr() const
     {
-        set_comperator(o._comp);
-
-        o._comp = nullptr;
+        std::stringstream ss;
+        for (size_t a = 0; a < _anchors.size(); ++a) {
+            if (a != 0)
+                ss << ", ";
+            ss << (_anchors[a].max ? "max(" : "min(") << _anchors[a].criteria << ")=" << _anchor_values[a];
+        }
 
-        return *this;
+        return ss.str();
     }
 
-    std::string criteria() const
+    bool operator()(const Mapping& map) const
     {
-        return _comp->criteria();
-    }
+        using detail::FilterOp;
 
-    std::string repr() const
-    {
-        return _comp->repr();
-    }
+        if (_code.empty())
+            return true;
 
-    bool operator()(const Mapping& map) const
-    try {
-        return _comp->comp(map);
-    } catch (std::runtime_error&) {
-        return false;
+        double stack[MAX_DEPTH];
+        size_t sp = 0;
+        bool missing = false;
+
+        for (const auto& i : _code) {
+            switch (i.op) {
+                case FilterOp::CONST:
+                    stack[sp++] = i.value;
+                    break;
+                case FilterOp::LOAD: {
+                    double v = map.characteristic(i.id);
+                    missing |= std::isnan(v);
+                    stack[sp++] = v;
+                    break;
+                }
+                case FilterOp::ANCHOR: {
+                    double v = _anchor_values[i.id];
+                    missing |= std::isnan(v);
+                    stack[sp++] = v;
+                    break;
+                }
+                case FilterOp::NEG:
+                    stack[sp-1] = -stack[sp-1];
+                    break;
+                case FilterOp::NOT:
+                    stack[sp-1] = stack[sp-1] == 0;
+                    break;
+                case FilterOp::ADD:
+                    --sp; stack[sp-1] = stack[sp-1] + stack[sp];
+                    break;
+                case FilterOp::SUB:
+                    --sp; stack[sp-1] = stack[sp-1] - stack[sp];
+                    break;
+                case FilterOp::MUL:
+                    --sp; stack[sp-1] = stack[sp-1] * stack[sp];
+                    break;
+                case FilterOp::DIV:
+                    --sp; stack[sp-1] = stack[sp-1] / stack[sp];
+                    break;
+                case FilterOp::LESS:
+                    --sp; stack[sp-1] = stack[sp-1] < stack[sp];
+                    break;
+                case FilterOp::LESS_EQUAL:
+                    --sp; stack[sp-1] = stack[sp-1] <= stack[sp];
+                    break;
+                case FilterOp::GREATER:
+                    --sp; stack[sp-1] = stack[sp-1] > stack[sp];
+                    break;
+                case FilterOp::GREATER_EQUAL:
+                    --sp; stack[sp-1] = stack[sp-1] >= stack[sp];
+                    break;
+                case FilterOp::EQUAL:
+                    --sp; stack[sp-1] = stack[sp-1] == stack[sp];
+                    break;
+                case FilterOp::NOT_EQUAL:
+                    --sp; stack[sp-1] = stack[sp-1] != stack[sp];
+                    break;
+                case FilterOp::AND:
+                    --sp; stack[sp-1] = stack[sp-1] != 0 && stack[sp] != 0;
+                    break;
+                case FilterOp::OR:
+                    --sp; stack[sp-1] = stack[sp-1] != 0 || stack[sp] != 0;
+                    break;
+            }
+        }
+
+        return !missing && stack[0] != 0;
     }
 };
 
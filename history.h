@@ -0,0 +1,72 @@
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#pragma once
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+class ArrivalHistory
+{
+   public:
+    using Clock = std::chrono::steady_clock;
+
+   private:
+    /* Weight of the newest inter-arrival time in the moving average. */
+    constexpr static double ALPHA = 0.3;
+
+    unsigned long       _arrivals;
+    Clock::time_point   _last;
+    double              _interarrival_s;
+
+    static double seconds(Clock::duration d)
+    {
+        return std::chrono::duration<double>(d).count();
+    }
+
+   public:
+    ArrivalHistory() :
+        _arrivals{0}, _last{}, _interarrival_s{0}
+    {}
+
+    void record(Clock::time_point now)
+    {
+        if (_arrivals == 1)
+            _interarrival_s = seconds(now - _last);
+        else if (_arrivals > 1)
+            _interarrival_s = ALPHA * seconds(now - _last) + (1 - ALPHA) * _interarrival_s;
+
+        _last = now;
+        ++_arrivals;
+    }
+
+    unsigned long arrivals() const
+    {
+        return _arrivals;
+    }
+
+    /* The expected arrival rate (per second). Once the program stays away for longer than
+     * usual, the time since its last arrival is used, so that finished bursts fade out. */
+    double rate(Clock::time_point now) const
+    {
+        if (_arrivals < 2)
+            return 0;
+
+        double interval = std::max(_interarrival_s, seconds(now - _last));
+        if (interval <= 0)
+            return 0;
+
+        return 1 / interval;
+    }
+
+    /* Probability of at least one arrival within the given horizon. */
+    double probability(Clock::time_point now, double horizon_s) const
+    {
+        return 1 - std::exp(-rate(now) * horizon_s);
+    }
+};
+
+#endif /* __HISTORY_H__ */
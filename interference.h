@@ -0,0 +1,164 @@
+#ifndef __INTERFERENCE_H__
+#define __INTERFERENCE_H__
+
+#pragma once
+
+
+#include "string_util.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/* How much a program slows down while another one runs on the same cluster, where they
+ * share the caches. The slowdowns are read from a file:
+ *
+ *     class     jpeg       membound
+ *     class     mplayer    membound
+ *     slowdown  membound   membound   1.4
+ *     slowdown  jpeg       htop       1.05
+ *
+ * A slowdown line gives the factor by which the first program (or class) runs slower next
+ * to the second one. Slowdowns of programs take precedence over those of their classes.
+ *
+ * Slowdowns can also be learned from the runtimes of programs which ran next to a single
+ * other program, relative to their runtimes without any neighbour. Learned slowdowns take
+ * precedence once they are backed by a few runs. */
+class Interference
+{
+   public:
+    struct Learned
+    {
+        unsigned long   runs = 0;
+        double          value = 1;
+    };
+
+   private:
+    /* Weight of the newest observation in the moving averages. */
+    constexpr static double ALPHA = 0.3;
+    constexpr static unsigned long MIN_RUNS = 3;
+
+    std::map<std::string, std::string> _classes;
+    std::map<std::pair<std::string, std::string>, double> _configured;
+
+    /* Runtime per unit of the characteristic without neighbours, and the learned slowdowns. */
+    std::map<std::string, Learned> _isolated;
+    std::map<std::pair<std::string, std::string>, Learned> _learned;
+
+    std::string class_of(const std::string& program) const
+    {
+        auto it = _classes.find(program);
+        return it != _classes.end() ? it->second : "";
+    }
+
+    static void update(Learned& l, double value)
+    {
+        l.value = l.runs == 0 ? value : ALPHA * value + (1 - ALPHA) * l.value;
+        ++l.runs;
+    }
+
+   public:
+    Interference() :
+        _classes{}, _configured{}, _isolated{}, _learned{}
+    {}
+
+    void load(const std::string& path)
+    {
+        std::ifstream in{path};
+        if (!in.is_open())
+            throw std::runtime_error{"Failed to open interference file " + path};
+
+        std::string line;
+        while (std::getline(in, line)) {
+            std::replace(line.begin(), line.end(), '\t', ' ');
+            line = string_util::strip(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+
+            std::vector<std::string> fields;
+            for (const auto& f : string_util::split(line, ' ')) {
+                if (!string_util::strip(f).empty())
+                    fields.push_back(string_util::strip(f));
+            }
+
+            if (fields[0] == "class" && fields.size() == 3) {
+                _classes[fields[1]] = fields[2];
+            } else if (fields[0] == "slowdown" && fields.size() == 4) {
+                try {
+                    _configured[{fields[1], fields[2]}] = std::stod(fields[3]);
+                } catch (std::exception&) {
+                    throw std::runtime_error{"Malformed slowdown: " + line};
+                }
+            } else {
+                throw std::runtime_error{"Malformed interference entry: " + line};
+            }
+        }
+    }
+
+    /* The factor by which the program runs slower next to the other one. */
+    double slowdown(const std::string& program, const std::string& other) const
+    {
+        auto l = _learned.find({program, other});
+        if (l != _learned.end() && l->second.runs >= MIN_RUNS)
+            return l->second.value;
+
+        auto pc = class_of(program), oc = class_of(other);
+        for (const auto& key : {std::make_pair(program, other), std::make_pair(program, oc), std::make_pair(pc, other),
+                std::make_pair(pc, oc)}) {
+            auto it = _configured.find(key);
+            if (!key.first.empty() && !key.second.empty() && it != _configured.end())
+                return it->second;
+        }
+
+        return 1;
+    }
+
+    /* The slowdown next to all of the given programs. */
+    double slowdown(const std::string& program, const std::vector<std::string>& others) const
+    {
+        double result = 1;
+        for (const auto& other : others)
+            result *= slowdown(program, other);
+
+        return result;
+    }
+
+    /* Learn from a run of the program which had the given neighbours at some time. The
+     * predicted value is the characteristic corresponding to the runtime. */
+    void observe(const std::string& program, const std::set<std::string>& neighbours, double predicted, double runtime)
+    {
+        if (predicted <= 0 || runtime <= 0)
+            return;
+
+        double ratio = runtime / predicted;
+        if (neighbours.empty()) {
+            update(_isolated[program], ratio);
+            return;
+        }
+
+        /* Runs next to several programs can't tell which one slowed them down. */
+        auto isolated = _isolated.find(program);
+        if (neighbours.size() != 1 || isolated == _isolated.end())
+            return;
+
+        update(_learned[{program, *neighbours.begin()}], std::max(1.0, ratio / isolated->second.value));
+    }
+
+    const std::map<std::pair<std::string, std::string>, Learned>& learned() const
+    {
+        return _learned;
+    }
+
+    const std::map<std::pair<std::string, std::string>, double>& configured() const
+    {
+        return _configured;
+    }
+};
+
+#endif /* __INTERFERENCE_H__ */
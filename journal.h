@@ -0,0 +1,153 @@
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#pragma once
+
+
+#include "tetris.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+
+/* Binary log of all input events of the manager. The file starts with a header, followed
+ * by records whose payload size depends on the event type. */
+class Journal
+{
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Event : uint32_t
+    {
+        CONNECT = 1,        /* No payload */
+        MESSAGE = 2,        /* TetrisData */
+        DISCONNECT = 3,     /* No payload */
+        CONTROL = 4,        /* ControlData */
+        RELOAD = 5          /* No payload */
+    };
+
+    struct Header
+    {
+        char            magic[8];
+        uint32_t        version;
+        uint32_t        reserved;
+    };
+
+    struct Record
+    {
+        Event           event;
+        int32_t         fd;
+        int64_t         time_ns;    /* Since the start of the journal */
+    };
+
+    constexpr static const char* MAGIC = "TETRISJ";
+    constexpr static uint32_t VERSION = 1;
+
+    static size_t payload_size(Event e)
+    {
+        switch (e) {
+            case Event::MESSAGE:
+                return sizeof(TetrisData);
+            case Event::CONTROL:
+                return sizeof(ControlData);
+            default:
+                return 0;
+        }
+    }
+
+   private:
+    std::ofstream       _out;
+    Clock::time_point   _start;
+
+   public:
+    Journal() :
+        _out{}, _start{}
+    {}
+
+    void open(const std::string& path, Clock::time_point start)
+    {
+        _out.open(path, std::ios::binary | std::ios::trunc);
+        if (!_out.is_open())
+            throw std::runtime_error{"Failed to open journal " + path};
+
+        _start = start;
+
+        Header h;
+        std::memset(&h, 0, sizeof(h));
+        std::strncpy(h.magic, MAGIC, sizeof(h.magic));
+        h.version = VERSION;
+
+        _out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        _out.flush();
+    }
+
+    bool enabled() const
+    {
+        return _out.is_open();
+    }
+
+    void record(Event e, int fd, Clock::time_point now, const void* payload = nullptr)
+    {
+        if (!enabled())
+            return;
+
+        Record r;
+        r.event = e;
+        r.fd = fd;
+        r.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _start).count();
+
+        _out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+        if (payload_size(e) != 0)
+            _out.write(reinterpret_cast<const char*>(payload), payload_size(e));
+
+        /* Keep the journal usable if the server dies. */
+        _out.flush();
+    }
+};
+
+class JournalReader
+{
+   private:
+    std::ifstream       _in;
+
+   public:
+    explicit JournalReader(const std::string& path) :
+        _in{path, std::ios::binary}
+    {
+        if (!_in.is_open())
+            throw std::runtime_error{"Failed to open journal " + path};
+
+        Journal::Header h;
+        if (!_in.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+                std::strncmp(h.magic, Journal::MAGIC, sizeof(h.magic)) != 0)
+            throw std::runtime_error{path + " is not a journal"};
+
+        if (h.version != Journal::VERSION)
+            throw std::runtime_error{"Unsupported journal version " + std::to_string(h.version)};
+    }
+
+    /* Read the next record. The payload is stored in the member matching the event type.
+     * Returns false at the end of the journal. */
+    bool next(Journal::Record& r, TetrisData& message, ControlData& control)
+    {
+        if (!_in.read(reinterpret_cast<char*>(&r), sizeof(r)))
+            return false;
+
+        bool ok = true;
+        if (r.event == Journal::Event::MESSAGE)
+            ok = static_cast<bool>(_in.read(reinterpret_cast<char*>(&message), sizeof(message)));
+        else if (r.event == Journal::Event::CONTROL)
+            ok = static_cast<bool>(_in.read(reinterpret_cast<char*>(&control), sizeof(control)));
+
+        if (!ok)
+            throw std::runtime_error{"Truncated journal record"};
+
+        return true;
+    }
+};
+
+#endif /* __JOURNAL_H__ */
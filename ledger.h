@@ -0,0 +1,179 @@
+#ifndef __LEDGER_H__
+#define __LEDGER_H__
+
+#pragma once
+
+
+#include "config.h"
+#include "cpulist.h"
+#include "mapping.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/* The share of each cpu which is in use. Cpus whose threads use them fully, or which
+ * belong to a client that asked for exclusive cpus, can't be shared at all. The others
+ * can be shared as long as their load stays within the limit.
+ *
+ * Further resources like memory are packed as well, with a capacity per node (a set of
+ * cpus). The demand of a mapping is its characteristic, split among the nodes in
+ * proportion to its cpus on them. */
+class Ledger
+{
+   public:
+    struct Dimension
+    {
+        std::string         criteria;
+        std::vector<CPUList> nodes;
+        std::vector<double> capacity;
+        std::vector<double> used;
+    };
+
+   private:
+    std::vector<double> _load;
+    CPUList             _exclusive;
+    double              _limit;
+    std::vector<Dimension> _dimensions;
+
+    static double demand(const Mapping& m, const std::string& criteria)
+    {
+        auto it = m.characteristics_map.find(criteria);
+        return it != m.characteristics_map.end() ? it->second : 0;
+    }
+
+    static double share(const Mapping& m, const CPUList& node)
+    {
+        int n = m.cpus.nr_cpus();
+        return n == 0 ? 0 : static_cast<double>((m.cpus & node).nr_cpus()) / n;
+    }
+
+    bool is_exclusive(int cpu) const
+    {
+        return _exclusive.overlaps_with(CPUList{cpu});
+    }
+
+    void account(const Mapping& m, double sign)
+    {
+        for (auto& d : _dimensions) {
+            double total = demand(m, d.criteria);
+            for (size_t i = 0; i < d.nodes.size(); ++i)
+                d.used[i] += sign * total * share(m, d.nodes[i]);
+        }
+    }
+
+   public:
+    explicit Ledger(double limit) :
+        _load(num_cpus, 0.0), _exclusive{}, _limit{limit}, _dimensions{}
+    {}
+
+    void add_dimension(const std::string& criteria, const std::vector<std::pair<CPUList, double>>& nodes)
+    {
+        Dimension d{criteria, {}, {}, {}};
+        for (const auto& [cpus, capacity] : nodes) {
+            d.nodes.push_back(cpus);
+            d.capacity.push_back(capacity);
+            d.used.push_back(0);
+        }
+
+        _dimensions.push_back(d);
+    }
+
+    const std::vector<Dimension>& dimensions() const
+    {
+        return _dimensions;
+    }
+
+    /* Account the further resources of a mapping, without its cpus. */
+    void add_resources(const Mapping& m)
+    {
+        account(m, 1);
+    }
+
+    /* Give the further resources of a mapping back, when its client moves elsewhere. */
+    void remove_resources(const Mapping& m)
+    {
+        account(m, -1);
+    }
+
+    void block(const CPUList& cpus)
+    {
+        _exclusive |= cpus;
+    }
+
+    void add(const Mapping& m, bool exclusive)
+    {
+        for (auto cpu : m.cpus.cpulist(num_cpus)) {
+            double l = m.load(cpu);
+
+            _load[cpu] += l;
+            if (exclusive || l >= 1.0)
+                _exclusive.set(cpu);
+        }
+
+        add_resources(m);
+    }
+
+    double load(int cpu) const
+    {
+        return is_exclusive(cpu) ? 1.0 : _load[cpu];
+    }
+
+    /* The cpus on which nothing of a client can be placed anymore. */
+    CPUList unavailable(bool exclusive) const
+    {
+        CPUList result = _exclusive;
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            if (_load[cpu] >= _limit || (exclusive && _load[cpu] > 0))
+                result.set(cpu);
+        }
+
+        return result;
+    }
+
+    /* The cpus which are in use, but could still host further threads. */
+    CPUList partial() const
+    {
+        CPUList result;
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            if (!is_exclusive(cpu) && _load[cpu] > 0)
+                result.set(cpu);
+        }
+
+        return result;
+    }
+
+    /* Whether the further resources of a mapping fit next to those in use. */
+    bool fits_resources(const Mapping& m) const
+    {
+        for (const auto& d : _dimensions) {
+            double total = demand(m, d.criteria);
+            for (size_t i = 0; i < d.nodes.size(); ++i) {
+                if (d.used[i] + total * share(m, d.nodes[i]) > d.capacity[i] + 1e-9)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool fits(const Mapping& m, bool exclusive) const
+    {
+        if (!fits_resources(m))
+            return false;
+
+        for (auto cpu : m.cpus.cpulist(num_cpus)) {
+            if (_load[cpu] == 0 && !is_exclusive(cpu))
+                continue;
+
+            double l = m.load(cpu);
+            if (exclusive || is_exclusive(cpu) || l >= 1.0 || _load[cpu] + l > _limit + 1e-9)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+#endif /* __LEDGER_H__ */
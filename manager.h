@@ -0,0 +1,4258 @@
+#ifndef __MANAGER_H__
+#define __MANAGER_H__
+
+#pragma once
+
+
+#include "algorithm.h"
+#include "client.h"
+#include "config.h"
+#include "cpulist.h"
+#include "csv.h"
+#include "debug_util.h"
+#include "explorer.h"
+#include "filter.h"
+#include "history.h"
+#include "interference.h"
+#include "journal.h"
+#include "ledger.h"
+#include "mapping.h"
+#include "parking.h"
+#include "path_util.h"
+#include "policy.h"
+#include "quota.h"
+#include "server_config.h"
+#include "string_util.h"
+#include "tetris.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+
+
+/***
+ * Server statistics
+ ***/
+
+struct ServerStats
+{
+    unsigned long   queued = 0;
+    unsigned long   admitted_from_queue = 0;
+    size_t          max_queue_length = 0;
+    double          total_wait_s = 0;
+    double          max_wait_s = 0;
+
+    unsigned long   suspended = 0;
+    unsigned long   suspend_timeouts = 0;
+
+    unsigned long   preemptions = 0;
+    unsigned long   preempted_clients = 0;
+
+    unsigned long   upgrades = 0;
+    double          upgrade_gain = 0;
+
+    unsigned long   fair_rebalances = 0;
+    unsigned long   fair_moves = 0;
+
+    unsigned long   synthesized = 0;
+
+    unsigned long   colocated = 0;
+
+    unsigned long   sliced = 0;
+    unsigned long   unsliced = 0;
+    unsigned long   rotations = 0;
+    unsigned long   slice_signals = 0;
+
+    unsigned long   batches = 0;
+    unsigned long   batched_clients = 0;
+    double          batch_wait_s = 0;
+    double          max_batch_wait_s = 0;
+    double          batch_solve_s = 0;
+    unsigned long   batch_placed = 0;
+    unsigned long   batch_greedy_placed = 0;
+    double          batch_objective = 0;
+    double          batch_greedy_objective = 0;
+
+    unsigned long   groups = 0;
+    unsigned long   groups_placed = 0;
+    unsigned long   groups_incomplete = 0;
+    unsigned long   groups_one_cluster = 0;
+
+    unsigned long   interfered = 0;
+    double          total_slowdown = 0;
+    double          max_slowdown = 1;
+    unsigned long   interference_observations = 0;
+
+    unsigned long   resource_restricted = 0;
+    unsigned long   resource_rejected = 0;
+
+    unsigned long   quota_restricted = 0;
+    unsigned long   quota_rejected = 0;
+
+    unsigned long   evacuations = 0;
+    unsigned long   evacuated_clients = 0;
+    unsigned long   stranded_clients = 0;
+    double          evacuation_s = 0;
+    double          max_evacuation_s = 0;
+
+    unsigned long   reservations = 0;
+    unsigned long   reservations_rejected = 0;
+    unsigned long   reservations_displaced = 0;
+    unsigned long   reservations_released = 0;
+    unsigned long   reservations_expired = 0;
+
+    unsigned long   explored_runs = 0;
+    unsigned long   explorations = 0;
+    unsigned long   observations = 0;
+
+    unsigned long   decisions = 0;
+    double          decision_time_s = 0;
+    unsigned long   deadline_hits = 0;
+    double          total_gap = 0;
+    double          max_gap = 0;
+    unsigned long   refinements = 0;
+    unsigned long   refined = 0;
+
+    unsigned long   budget_downgrades = 0;
+
+    unsigned long   arrivals = 0;
+    unsigned long   predicted_arrivals = 0;
+    unsigned long   prediction_hits = 0;
+    double          prediction_saved_s = 0;
+};
+
+/* Time passed on the platform's clock. */
+inline double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(platform->now() - start).count();
+}
+
+/* Real time passed, used to measure the manager's own work. */
+inline double elapsed_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+/***
+ * Failure handling for no mapping found
+ ***/
+
+class NoMappingError : public std::runtime_error
+{
+   public:
+    using std::runtime_error::runtime_error;
+};
+
+
+/***
+ * Placement policies
+ ***/
+
+/* The best candidate in the client's compare criteria, the first one of equally good ones. */
+class GreedyPolicy : public PlacementPolicy
+{
+   public:
+    std::string name() const override
+    {
+        return "greedy";
+    }
+
+    int choose(const PolicyClient& client, const std::vector<Mapping>& candidates, const Ledger&) override
+    {
+        if (candidates.empty())
+            return -1;
+
+        Client::Comp comp{client.criteria, client.more_is_better};
+
+        size_t best = 0;
+        logger->debug(" * Start search with mapping: %s (%.0f@%s) [%s]\n", candidates[best].name.c_str(),
+                candidates[best].characteristic(client.criteria), comp.repr().c_str(),
+                candidates[best].equivalence_class().name().c_str());
+
+        for (size_t i = 1; i < candidates.size(); ++i) {
+            const Mapping& m = candidates[i];
+            if (comp(m, candidates[best])) {
+                logger->debug(" * Found better mapping: %s (%.0f@%s) [%s] vs %s (%.0f@%s) [%s]\n",
+                        m.name.c_str(), m.characteristic(client.criteria),
+                        comp.repr().c_str(), m.equivalence_class().name().c_str(),
+                        candidates[best].name.c_str(), candidates[best].characteristic(client.criteria),
+                        comp.repr().c_str(), candidates[best].equivalence_class().name().c_str());
+
+                /* Remember this one as best one */
+                best = i;
+            }
+        }
+
+        return static_cast<int>(best);
+    }
+};
+
+/* Load a policy from a shared object, or the built-in one of the given name. */
+inline PlacementPolicyPtr load_policy(const std::string& path, const std::string& args)
+{
+    if (path.empty() || path == "greedy")
+        return std::make_shared<GreedyPolicy>();
+
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr)
+        throw std::runtime_error{"Failed to load policy " + path + ": " + dlerror()};
+
+    auto version = reinterpret_cast<int (*)()>(dlsym(handle, "tetris_policy_api_version"));
+    auto create = reinterpret_cast<PlacementPolicy* (*)(const char*)>(dlsym(handle, "tetris_create_policy"));
+    if (version == nullptr || create == nullptr) {
+        dlclose(handle);
+        throw std::runtime_error{path + " is not a placement policy"};
+    }
+
+    if (version() != TETRIS_POLICY_API_VERSION) {
+        dlclose(handle);
+        throw std::runtime_error{path + " was built for policy interface version " + std::to_string(version())};
+    }
+
+    PlacementPolicy* policy = create(args.c_str());
+    if (policy == nullptr) {
+        dlclose(handle);
+        throw std::runtime_error{"Failed to create policy from " + path};
+    }
+
+    /* The policy's code has to stay around until the policy is gone. */
+    return PlacementPolicyPtr{policy, [handle](PlacementPolicy* p) {
+        delete p;
+        dlclose(handle);
+    }};
+}
+
+
+/***
+ * Client Manager
+ ***/
+
+class Manager
+{
+   private:
+    std::map<int, Client>   _clients;
+    std::string             _mappings_path;
+    std::map<std::string, std::vector<Mapping>> _mappings;
+
+    /* The cpus blocked by hand together with those of the reservations. */
+    CPUList                 _blocked_cpus;
+    CPUList                 _blocked_manually;
+
+    struct Reservation
+    {
+        std::string         job;
+        CPUList             cpus;
+        int                 priority;
+        Clock::time_point   start;
+        Clock::time_point   end;
+        bool                started;
+    };
+
+    std::map<std::string, Reservation> _reservations;
+
+    ServerConfig            _config;
+    CPUParking              _parking;
+    PlacementPolicyPtr      _policy;
+    Quotas                  _quotas;
+
+    ServerStats             _stats;
+
+    struct Prediction
+    {
+        ArrivalHistory      history;
+
+        /* The properties the program was started with the last time. */
+        int                 priority = 0;
+        bool                dynamic_client = false;
+        Client::Comp        comp;
+        Filter              filter;
+
+        bool                likely = false;
+        bool                has_mapping = false;
+        Mapping             mapping;
+        unsigned long       generation = 0;
+        double              search_s = 0;
+    };
+
+    std::map<std::string, Prediction> _predictions;
+    unsigned long           _generation;
+
+    /* Set while the mappings of likely newcomers are precomputed. Their searches ignore the
+     * headroom, don't explore and don't count in the statistics. */
+    bool                    _probing;
+
+    Journal                 _journal;
+
+    Explorer                _explorer;
+    Interference            _interference;
+
+    /* The end of the current decision's search time and the outcome of the last search. */
+    Clock::time_point       _deadline;
+    bool                    _truncated;
+    double                  _gap;
+
+    /* The time slot whose clients run, and the slot a mapping is searched in (0 for the
+     * cpus next to the running clients). */
+    int                     _active_slot;
+    Clock::time_point       _slot_start;
+    int                     _placing_slot;
+
+    /* The arrival of the first client of the batch which is not yet placed. */
+    Clock::time_point       _batch_start;
+
+    std::vector<Mapping> parse_mapping(const std::string& file)
+    {
+        CSVData data{file};
+        std::vector<Mapping> mappings;
+
+        for (const auto& row : data.row_iter()) {
+            std::vector<std::pair<std::string, std::string>> threads;
+            std::vector<std::pair<std::string, std::string>> characteristics;
+
+            std::vector<std::pair<std::string, double>> utilisations;
+
+            for (const auto& col : row.names()) {
+                if (string_util::starts_with(col, "t_")) {
+                    /* Columns starting with 't_' are interpreted as threads */
+                    std::string thread_name = col.substr(2);
+                    std::string cpu_name = row(col);
+
+                    threads.emplace_back(thread_name, cpu_name);
+                } else if (string_util::starts_with(col, "u_")) {
+                    /* Columns starting with 'u_' are the cpu utilisation of a thread */
+                    utilisations.emplace_back(col.substr(2), std::stod(row(col)));
+                } else {
+                    /* All the other columns are characteristics of the mapping */
+                    std::string value = row(col);
+
+                    characteristics.emplace_back(col, value);
+                }
+            }
+
+            auto name = row.fixed();
+
+            mappings.emplace_back(name, threads, characteristics);
+            for (const auto& [thread, utilisation] : utilisations)
+                mappings.back().utilisation_map[thread] = std::clamp(utilisation, 0.0, 1.0);
+        }
+
+        {
+            std::vector<std::string> thread_names;
+            std::vector<std::string> characteristic_names;
+            std::vector<std::string> utilisation_names;
+
+            for (const auto& col : data.columns()) {
+                if (string_util::starts_with(col, "t_"))
+                    thread_names.push_back(col.substr(2));
+                else if (string_util::starts_with(col, "u_"))
+                    utilisation_names.push_back(col.substr(2));
+                else
+                    characteristic_names.push_back(col);
+            }
+
+            logger->debug("  * Found %i mapping(s)\n", mappings.size());
+            logger->debug("  |-> %i thread(s): %s\n", thread_names.size(),
+                    string_util::join(thread_names, ",").c_str());
+            logger->debug("  |-> %i characteristic(s): %s\n", characteristic_names.size(),
+                    string_util::join(characteristic_names, ",").c_str());
+            if (!utilisation_names.empty())
+                logger->debug("  |-> %i thread utilisation(s): %s\n", utilisation_names.size(),
+                        string_util::join(utilisation_names, ",").c_str());
+
+            for (const auto& m : mappings) {
+                std::vector<std::string> mapping_characterisics;
+
+                for (const auto& c : characteristic_names) {
+                    std::stringstream ss;
+
+                    ss << std::setprecision(0) << std::fixed << c << ":" << m.characteristic(c);
+                    mapping_characterisics.push_back(ss.str());
+                }
+
+                logger->debug("  |=> %s [%s] %s\n", m.name.c_str(),
+                        m.equivalence_class().name().c_str(),
+                        string_util::join(mapping_characterisics, ",").c_str());
+            }
+        }
+
+        return mappings;
+    }
+
+    static Filter parse_filter(const char* text, size_t size)
+    {
+        std::string criteria{text, strnlen(text, size)};
+
+        try {
+            return Filter{criteria};
+        } catch (FilterError& e) {
+            logger->warning("%s, using no filter\n", e.what());
+            return Filter{};
+        }
+    }
+
+    Mapping select_best_mapping(Client& c, const CPUList& reserved = CPUList{})
+    {
+        logger->info("Search for best mapping for '%s' [%d] using criteria %s\n", c.exec.c_str(), c.pid, c.comp.repr().c_str());
+
+        /* First go through all mappings and take those that satisfy our filter criteria.
+         * Relative filters can only be checked once the fitting candidates are known. */
+        auto filter = [&c] (const Mapping& m) -> bool {
+            return c.filter(m);
+        };
+
+        std::vector<Mapping> possible_mappings;
+        for (const auto& m : c.mappings) {
+            if (c.filter.relative() || filter(m))
+                possible_mappings.push_back(m);
+            else
+                logger->debug(" * Mapping %s (%.0f@%s) [%s] doesn't satisfy filter criteria %s\n",
+                        m.name.c_str(), m.characteristic(c.comp.criteria()), c.comp.criteria().c_str(),
+                        m.equivalence_class().name().c_str(), c.filter.repr().c_str());
+        }
+
+
+        if (possible_mappings.empty()) {
+            logger->debug("No mappings are available for client '%s' [%i] that satisfy the filter\n", c.exec.c_str(), c.pid);
+            throw NoMappingError("Can't find mapping that satisfies the filter.");
+        } else
+            logger->debug(" * There are %i mapping(s) for this client that satisfy the filter\n", possible_mappings.size());
+
+        /* Now get all the mappings (containing equivalent ones) from the possible ones,
+         * that still fit on the non-occupied CPUs. */
+        Ledger ledger = this->ledger(&c);
+        CPUList occupied_cpus;
+        if (_placing_slot > 0)
+            occupied_cpus = slot_cpus(_placing_slot, &c) | reserved;
+        else
+            occupied_cpus = (_config.colocate_limit > 0 ? ledger.unavailable(c.exclusive) : occupied(c)) | reserved;
+
+        if (occupied_cpus.nr_cpus() == 0)
+            logger->debug(" * Already taken cpu(s): none\n");
+        else
+            logger->debug(" * Already taken cpu(s): %s\n", string_util::join(occupied_cpus.cpulist(num_cpus), ",").c_str());
+
+        /* Dynamic clients only use the cpus of a mapping, so only the best mapping per cpuset
+         * matters. That doesn't hold if other characteristics decide as well: the energy, the
+         * load of the threads on shared cpus or the memory. */
+        bool collapse = c.dynamic_client && !c.filter.relative() && _config.energy_budget <= 0 &&
+            _config.colocate_limit <= 0 && ledger.dimensions().empty();
+        if (collapse) {
+            auto n = possible_mappings.size();
+            possible_mappings = distinct_cpusets(c, possible_mappings);
+            logger->debug(" * Dynamic client: %i distinct cpuset(s) out of %i mapping(s)\n", possible_mappings.size(), n);
+        }
+
+        /* Get all the TETRiS mappings for this client. Within a deadline, only as many as there
+         * is time for, starting with the best ranked ones. */
+        double bound = 0;
+        _truncated = false;
+
+        std::vector<Mapping> possible_tetris_mappings;
+        if (_deadline != Clock::time_point::max() && !c.filter.relative()) {
+            /* Stop at the deadline only once a candidate passed the filters below as well. */
+            double remaining = _config.energy_budget - energy_total(&c);
+            auto headroom = headroom_for(c);
+            auto acceptable = [&](const Mapping& m) {
+                return (_config.colocate_limit <= 0 || _placing_slot != 0 || ledger.fits(m, c.exclusive)) &&
+                    (_config.energy_budget <= 0 || energy_of(m) <= remaining) && ledger.fits_resources(m) &&
+                    (_quotas.empty() || within_quota(c, m)) && !headroom.overlaps_with(m.cpus);
+            };
+
+            possible_tetris_mappings = anytime_mappings(c, possible_mappings, occupied_cpus, acceptable, bound);
+        } else
+            possible_tetris_mappings = tetris_mappings(possible_mappings, occupied_cpus);
+
+        /* Equivalent placements of different mappings can end up on the same cpus. */
+        if (collapse)
+            possible_tetris_mappings = distinct_cpusets(c, possible_tetris_mappings);
+
+        /* Partly used cpus can only take mappings which stay within the co-location limit. */
+        if (_config.colocate_limit > 0 && _placing_slot == 0) {
+            possible_tetris_mappings.erase(std::remove_if(possible_tetris_mappings.begin(), possible_tetris_mappings.end(),
+                        [&](const Mapping& m) { return !ledger.fits(m, c.exclusive); }), possible_tetris_mappings.end());
+        }
+
+        if (possible_tetris_mappings.empty()) {
+            logger->debug("No TETRiS mappings are available for client '%s' [%i] that fit the available cpu(s)\n", c.exec.c_str(), c.pid);
+            throw NoMappingError("Can't find a proper TETRiS mapping for the client.");
+        } else
+            logger->debug(" * There are %i TETRiS mapping(s) for this client that fit the available cpu(s)\n",
+                    possible_tetris_mappings.size());
+
+        /* Only consider mappings which keep the system within the energy budget. */
+        if (_config.energy_budget > 0) {
+            double remaining = _config.energy_budget - energy_total(&c);
+
+            std::vector<Mapping> within;
+            for (const auto& m : possible_tetris_mappings) {
+                if (energy_of(m) <= remaining)
+                    within.push_back(m);
+            }
+
+            if (within.empty()) {
+                logger->debug("No TETRiS mappings are available for client '%s' [%i] within the energy budget (%.0f left)\n",
+                        c.exec.c_str(), c.pid, remaining);
+                throw NoMappingError("Can't find a TETRiS mapping within the energy budget.");
+            }
+
+            logger->debug(" * There are %i TETRiS mapping(s) within the energy budget (%.0f left)\n", within.size(), remaining);
+            possible_tetris_mappings = within;
+        }
+
+        /* The memory and bandwidth of the mapping have to fit next to those of the others. */
+        if (!ledger.dimensions().empty()) {
+            auto n = possible_tetris_mappings.size();
+            possible_tetris_mappings.erase(std::remove_if(possible_tetris_mappings.begin(), possible_tetris_mappings.end(),
+                        [&](const Mapping& m) { return !ledger.fits_resources(m); }), possible_tetris_mappings.end());
+
+            if (possible_tetris_mappings.empty()) {
+                logger->debug("No TETRiS mappings are available for client '%s' [%i] that fit the available memory\n",
+                        c.exec.c_str(), c.pid);
+                if (!_probing)
+                    ++_stats.resource_rejected;
+                throw NoMappingError("Can't find a TETRiS mapping that fits the available memory.");
+            }
+
+            if (possible_tetris_mappings.size() < n) {
+                logger->debug(" * There are %i TETRiS mapping(s) that fit the available memory\n", possible_tetris_mappings.size());
+                if (!_probing)
+                    ++_stats.resource_restricted;
+            }
+        }
+
+        /* Only consider mappings which keep the client's user and cgroup within their quotas. */
+        if (!_quotas.empty()) {
+            std::vector<Mapping> within;
+            for (const auto& m : possible_tetris_mappings) {
+                if (within_quota(c, m))
+                    within.push_back(m);
+            }
+
+            if (within.empty()) {
+                logger->debug("No TETRiS mappings are available for client '%s' [%i] within the quotas\n", c.exec.c_str(), c.pid);
+                if (!_probing)
+                    ++_stats.quota_rejected;
+                throw NoMappingError("Can't find a TETRiS mapping within the quotas.");
+            }
+
+            if (within.size() < possible_tetris_mappings.size()) {
+                logger->debug(" * There are %i TETRiS mapping(s) within the quotas\n", within.size());
+                if (!_probing)
+                    ++_stats.quota_restricted;
+            }
+
+            possible_tetris_mappings = within;
+        }
+
+        /* Keep the headroom for likely arrivals free, as long as there are other options. */
+        auto headroom = headroom_for(c);
+        if (headroom.nr_cpus() != 0) {
+            std::vector<Mapping> outside;
+            for (const auto& m : possible_tetris_mappings) {
+                if (!headroom.overlaps_with(m.cpus))
+                    outside.push_back(m);
+            }
+
+            if (!outside.empty()) {
+                logger->debug(" * Keep headroom cpu(s) %s free, %i mapping(s) remain\n",
+                        string_util::join(headroom.cpulist(num_cpus), ",").c_str(), outside.size());
+                possible_tetris_mappings = outside;
+            } else {
+                logger->debug(" * All mappings overlap the headroom cpu(s) %s\n",
+                        string_util::join(headroom.cpulist(num_cpus), ",").c_str());
+            }
+        }
+
+        /* Relative filters refer to the best values among the remaining candidates. */
+        if (c.filter.relative()) {
+            c.filter.anchor(possible_tetris_mappings.begin(), possible_tetris_mappings.end());
+            logger->debug(" * Anchored filter %s at %s\n", c.filter.repr().c_str(), c.filter.anchors_repr().c_str());
+        }
+
+        /* Now let the policy select one out of the remaining ones. */
+        std::vector<Mapping> candidates;
+        std::copy_if(possible_tetris_mappings.begin(), possible_tetris_mappings.end(), std::back_inserter(candidates), filter);
+        if (candidates.empty()) {
+            logger->debug("No TETRiS mappings for client '%s' [%i] satisfy the filter\n", c.exec.c_str(), c.pid);
+            throw NoMappingError("Can't find a TETRiS mapping that satisfies the filter.");
+        }
+
+        int choice = policy_choice(c, candidates, ledger);
+        if (choice < 0) {
+            logger->debug("The %s policy accepts none of the mappings for client '%s' [%i]\n", _policy->name().c_str(),
+                    c.exec.c_str(), c.pid);
+            throw NoMappingError("The placement policy accepts none of the mappings.");
+        }
+
+        if (c.state == Client::State::NEW && !_probing)
+            choice = explore(c, candidates, choice);
+
+        auto best = candidates.begin() + choice;
+
+        logger->info("The best mapping: %s (%.0f@%s) [%s]\n", best->name.c_str(),
+                best->characteristic(c.comp.criteria()), c.comp.repr().c_str(),
+                best->equivalence_class().name().c_str());
+
+        /* None of the mappings which were not looked at can be better than the bound. */
+        if (_truncated) {
+            _gap = std::max(0.0, c.comp.degradation(*best, bound));
+            logger->info(" * search stopped at the deadline, optimality gap %.1f%%\n", 100 * _gap);
+        }
+
+        double slowdown = interference_enabled() ? this->slowdown(c, *best) : 1;
+        if (slowdown > 1)
+            logger->info(" * expected slowdown next to %s: %.2f\n", string_util::join(neighbour_programs(c, best->cpus), ",").c_str(),
+                    slowdown);
+
+        auto shared = best->cpus & ledger.partial();
+        if (_config.colocate_limit > 0 && _placing_slot == 0 && shared.nr_cpus() != 0) {
+            logger->info(" * shares cpu(s) %s with other clients\n", string_util::join(shared.cpulist(num_cpus), ",").c_str());
+            if (!_probing)
+                ++_stats.colocated;
+        }
+
+        return *best;
+    }
+
+    /* The index of the candidate the policy chooses, -1 if it accepts none. The policy sees the
+     * characteristics expected next to the clients on the same clusters. */
+    int policy_choice(const Client& c, const std::vector<Mapping>& candidates, const Ledger& ledger)
+    {
+        if (candidates.empty())
+            return -1;
+
+        int choice = _policy->choose(policy_client(c), interference_enabled() ? interfered(c, candidates) : candidates, ledger);
+        return choice >= 0 && static_cast<size_t>(choice) < candidates.size() ? choice : -1;
+    }
+
+    static PolicyClient policy_client(const Client& c)
+    {
+        PolicyClient result;
+        result.exec = c.exec;
+        result.pid = c.pid;
+        result.dynamic_client = c.dynamic_client;
+        result.priority = c.priority;
+        result.exclusive = c.exclusive;
+        result.group = c.group;
+        result.criteria = c.comp.criteria();
+        result.criteria_id = CharacteristicIds::id(result.criteria);
+        result.more_is_better = c.comp.more_is_better();
+
+        return result;
+    }
+
+    /***
+     * Exploration of near-best mappings
+     ***/
+
+    double explore_rate(const std::string& exec) const
+    {
+        auto it = _config.explore_rates.find(exec);
+        return it != _config.explore_rates.end() ? it->second : _config.explore_rate;
+    }
+
+    /* Only the runtime of a client is observed, so only clients which minimize it learn. */
+    bool exploring(const Client& c) const
+    {
+        return _config.explore && explore_rate(c.exec) > 0 && c.comp.criteria() == _config.explore_criteria &&
+            !c.comp.more_is_better();
+    }
+
+    /* Let the learned runtimes choose among the mappings which are predicted to be within the
+     * tolerance of the policy's choice. Equivalent placements of a mapping are one arm. */
+    int explore(const Client& c, const std::vector<Mapping>& candidates, int choice)
+    {
+        if (!exploring(c))
+            return choice;
+
+        const auto& chosen = candidates[choice];
+        double reference = chosen.characteristic(c.comp.criteria());
+
+        std::vector<int> arms{choice};
+        std::vector<std::string> names{chosen.name};
+        std::vector<double> predicted{reference};
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const auto& m = candidates[i];
+            if (std::find(names.begin(), names.end(), m.name) != names.end() ||
+                    c.comp.degradation(m, reference) > _config.explore_tolerance)
+                continue;
+
+            arms.push_back(static_cast<int>(i));
+            names.push_back(m.name);
+            predicted.push_back(m.characteristic(c.comp.criteria()));
+        }
+
+        ++_stats.explored_runs;
+
+        bool sample = _explorer.draw(explore_rate(c.exec));
+        int arm = _explorer.choose(c.exec, names, predicted, sample);
+        if (arm < 0)
+            return choice;
+
+        logger->debug(" * %s among %d near-best mapping(s): %s\n", sample ? "Explore" : "Exploit", names.size(),
+                names[arm].c_str());
+
+        if (arms[arm] != choice) {
+            logger->info(" * %s %s instead of %s\n", sample ? "exploring" : "learned", names[arm].c_str(), chosen.name.c_str());
+            ++_stats.explorations;
+        }
+
+        return arms[arm];
+    }
+
+    /* Start observing the runtime of a client which was placed for exploration. */
+    void start_run(Client& c)
+    {
+        if (!exploring(c) && !_config.interference_learn)
+            return;
+
+        c.run_mapping = c.active_mapping.name;
+        c.run_predicted = c.active_mapping.characteristic(c.comp.criteria());
+        c.run_start = platform->now();
+
+        auto neighbours = neighbour_programs(c, c.cpus());
+        c.run_neighbours = {neighbours.begin(), neighbours.end()};
+    }
+
+    /* Runs which didn't stay on their mapping tell nothing about it. */
+    void finish_run(const Client& c)
+    {
+        if (c.run_mapping.empty() || c.state != Client::State::RUNNING || c.active_mapping.name != c.run_mapping)
+            return;
+
+        double runtime = seconds_since(c.run_start);
+        if (runtime <= 0)
+            return;
+
+        logger->info(" * observed runtime of '%s' on %s: %.3f s\n", c.exec.c_str(), c.run_mapping.c_str(), runtime);
+
+        if (_config.interference_learn) {
+            auto it = c.active_mapping.characteristics_map.find(_config.interference_criteria);
+            if (it != c.active_mapping.characteristics_map.end()) {
+                _interference.observe(c.exec, c.run_neighbours, it->second, runtime);
+                ++_stats.interference_observations;
+            }
+        }
+
+        if (!exploring(c))
+            return;
+
+        _explorer.record(c.exec, c.run_mapping, c.run_predicted, runtime);
+        ++_stats.observations;
+
+        if (!_config.explore_state_path.empty()) {
+            try {
+                _explorer.save(_config.explore_state_path);
+            } catch (std::runtime_error& e) {
+                logger->error("%s\n", e.what());
+            }
+        }
+    }
+
+    /***
+     * Interference of clients sharing a cluster
+     ***/
+
+    bool interference_enabled() const
+    {
+        return !_config.interference_path.empty() || _config.interference_learn;
+    }
+
+    static bool share_cluster(const CPUList& a, const CPUList& b)
+    {
+        return std::any_of(clusters.begin(), clusters.end(), [&](const Cluster& cluster) {
+                return a.overlaps_with(cluster.cpus) && b.overlaps_with(cluster.cpus);
+        });
+    }
+
+    /* The programs of the running clients which share a cluster with the given cpus. */
+    std::vector<std::string> neighbour_programs(const Client& c, const CPUList& cpus) const
+    {
+        std::vector<std::string> result;
+        for (const auto& [fd, cl] : _clients) {
+            if (&cl != &c && cl.state == Client::State::RUNNING && share_cluster(cpus, cl.cpus()))
+                result.push_back(cl.exec);
+        }
+
+        return result;
+    }
+
+    double slowdown(const Client& c, const Mapping& m) const
+    {
+        return _interference.slowdown(c.exec, neighbour_programs(c, m.cpus));
+    }
+
+    /* The candidates with the characteristic the slowdowns apply to scaled by the slowdown. */
+    std::vector<Mapping> interfered(const Client& c, const std::vector<Mapping>& candidates) const
+    {
+        const auto& criteria = _config.interference_criteria;
+
+        std::vector<Mapping> result = candidates;
+        for (auto& m : result) {
+            auto it = m.characteristics_map.find(criteria);
+            double s = slowdown(c, m);
+            if (it == m.characteristics_map.end() || s == 1)
+                continue;
+
+            m.set_characteristic(criteria, c.comp.criteria() == criteria && c.comp.more_is_better() ? it->second / s : it->second * s);
+        }
+
+        return result;
+    }
+
+    /* The best mapping for each distinct cpuset, in the order of their first appearance. */
+    static std::vector<Mapping> distinct_cpusets(Client& c, const std::vector<Mapping>& mappings)
+    {
+        std::vector<Mapping> result;
+        std::map<std::vector<int>, size_t> index;
+
+        for (const auto& m : mappings) {
+            auto it = index.emplace(m.cpus.cpulist(num_cpus), result.size());
+            if (it.second)
+                result.push_back(m);
+            else if (c.comp(m, result[it.first->second]))
+                result[it.first->second] = m;
+        }
+
+        return result;
+    }
+
+    /* The TETRiS mappings of the given best-first ranked mappings, until the deadline passes
+     * and one of them is acceptable. bound is set to the characteristic of the first mapping
+     * that was not looked at. */
+    std::vector<Mapping> anytime_mappings(const Client& c, const std::vector<Mapping>& ranked, const CPUList& occupied_cpus,
+            const std::function<bool(const Mapping&)>& acceptable, double& bound)
+    {
+        std::vector<Mapping> result;
+        bool found = false;
+
+        for (auto m = ranked.begin(); m != ranked.end(); ++m) {
+            if (found && Clock::now() >= _deadline) {
+                _truncated = true;
+                bound = m->characteristic(c.comp.criteria());
+                logger->debug(" * Deadline reached after %i of %i mapping(s)\n", m - ranked.begin(), ranked.size());
+                break;
+            }
+
+            for (const auto& equiv_m : m->equivalent_mappings()) {
+                if (occupied_cpus.overlaps_with(equiv_m.cpus))
+                    continue;
+
+                result.push_back(equiv_m);
+                found = found || acceptable(equiv_m);
+            }
+        }
+
+        return result;
+    }
+
+    /* Order the client's mappings best first, so that searches with a deadline look at the
+     * most promising ones first. The sort is stable, so that ties are resolved as before. */
+    void rank_mappings(Client& c)
+    {
+        if (_config.deadline_s <= 0)
+            return;
+
+        std::stable_sort(c.mappings.begin(), c.mappings.end(), [&c] (const Mapping& a, const Mapping& b) {
+            return c.comp(a, b);
+        });
+    }
+
+    /* Derive a mapping for the free cpus from the stored mapping closest in size, by folding
+     * its threads onto the free cpus of the same cluster type where possible. */
+    Mapping synthesize(Client& c)
+    {
+        CPUList taken = occupied(c);
+        CPUList free;
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            if (!taken.overlaps_with(CPUList{cpu}))
+                free.set(cpu);
+        }
+
+        int nr_free = free.nr_cpus();
+        if (nr_free == 0)
+            throw NoMappingError("No free cpus to synthesize a mapping on.");
+
+        /* The smallest mapping which is at least as large as the free cpus, otherwise the
+         * largest one. */
+        auto mappings = filtered_mappings(c);
+        const Mapping* base = nullptr;
+        for (const auto& m : mappings) {
+            if (!base) {
+                base = &m;
+                continue;
+            }
+
+            int n = m.cpus.nr_cpus(), nb = base->cpus.nr_cpus();
+            bool closer = n >= nr_free ? (nb < nr_free || n < nb) : (nb < nr_free && n > nb);
+            if (closer || (n == nb && c.comp(m, *base)))
+                base = &m;
+        }
+
+        if (!base)
+            throw NoMappingError("No mapping to synthesize from.");
+
+        auto cluster_of = [](int cpu) -> int {
+            for (size_t i = 0; i < clusters.size(); ++i) {
+                if (clusters[i].cpus.overlaps_with(CPUList{cpu}))
+                    return static_cast<int>(i);
+            }
+            return -1;
+        };
+
+        std::map<int, int> conv_map;
+        std::map<int, int> load;
+        for (auto src : base->cpus.cpulist(num_cpus)) {
+            int target = -1;
+            for (bool same_cluster : {true, false}) {
+                for (auto cpu : free.cpulist(num_cpus)) {
+                    if (same_cluster && cluster_of(cpu) != cluster_of(src))
+                        continue;
+
+                    if (target == -1 || load[cpu] < load[target])
+                        target = cpu;
+                }
+
+                if (target != -1)
+                    break;
+            }
+
+            conv_map[src] = target;
+            ++load[target];
+        }
+
+        Mapping m = base->folded(conv_map);
+        m.name = base->name + "-synth";
+        m.synthesized = true;
+
+        double factor = static_cast<double>(base->cpus.nr_cpus()) / m.cpus.nr_cpus();
+        for (const auto& [criteria, exponent] : _config.synth_model) {
+            auto it = m.characteristics_map.find(criteria);
+            if (it != m.characteristics_map.end())
+                m.set_characteristic(criteria, it->second * std::pow(factor, exponent));
+        }
+
+        if (_config.energy_budget > 0 && energy_total(&c) + energy_of(m) > _config.energy_budget)
+            throw NoMappingError("The synthesized mapping exceeds the energy budget.");
+
+        if (!within_quota(c, m))
+            throw NoMappingError("The synthesized mapping exceeds the quotas.");
+
+        if (!ledger(&c).fits_resources(m))
+            throw NoMappingError("The synthesized mapping doesn't fit the available memory.");
+
+        logger->info("Synthesized mapping %s for '%s' [%d] by folding %i cpu(s) onto %s\n", m.name.c_str(),
+                c.exec.c_str(), c.pid, base->cpus.nr_cpus(), string_util::join(m.cpus.cpulist(num_cpus), ",").c_str());
+
+        ++_stats.synthesized;
+
+        return m;
+    }
+
+    /* A placement decision for a new client, bounded by the deadline if there is one. */
+    Mapping decide(Client& c)
+    {
+        auto start = Clock::now();
+
+        if (_config.deadline_s > 0)
+            _deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_config.deadline_s));
+        _truncated = false;
+        _gap = 0;
+
+        Mapping m;
+        try {
+            try {
+                m = select_with_preemption(c);
+            } catch (NoMappingError&) {
+                if (!_config.synthesize)
+                    throw;
+
+                m = synthesize(c);
+            }
+        } catch (NoMappingError&) {
+            _deadline = Clock::time_point::max();
+            ++_stats.decisions;
+            _stats.decision_time_s += elapsed_since(start);
+            throw;
+        }
+
+        _deadline = Clock::time_point::max();
+        ++_stats.decisions;
+        _stats.decision_time_s += elapsed_since(start);
+
+        if (_truncated) {
+            ++_stats.deadline_hits;
+            _stats.total_gap += _gap;
+            _stats.max_gap = std::max(_stats.max_gap, _gap);
+
+            /* Look for the optimal mapping once the client is running. */
+            c.refine = _config.refine && _gap > 0;
+        }
+
+        return m;
+    }
+
+    /* Complete the searches which were stopped at their deadline and move the clients if
+     * there is a better mapping. */
+    void refine_mappings()
+    {
+        for (auto& [fd, cl] : _clients) {
+            if (!cl.refine)
+                continue;
+
+            cl.refine = false;
+            if (cl.state != Client::State::RUNNING)
+                continue;
+
+            ++_stats.refinements;
+            try {
+                auto m = select_best_mapping(cl);
+                if (cl.comp(m, cl.active_mapping)) {
+                    logger->info("Refined mapping for client '%s' [%d]: %s (%.0f@%s)\n", cl.exec.c_str(), cl.pid,
+                            m.name.c_str(), m.characteristic(cl.comp.criteria()), cl.comp.repr().c_str());
+
+                    apply_mapping(cl, m);
+                    set_reference(cl);
+                    ++_stats.refined;
+                }
+            } catch (NoMappingError&) {
+                /* The current mapping stays. */
+            }
+        }
+    }
+
+    std::vector<Mapping> filtered_mappings(Client& c)
+    {
+        /* Without a machine state, relative filters refer to the whole database. */
+        if (c.filter.relative())
+            c.filter.anchor(c.mappings.begin(), c.mappings.end());
+
+        std::vector<Mapping> result;
+        for (const auto& m : c.mappings) {
+            if (c.filter(m))
+                result.push_back(m);
+        }
+
+        return result;
+    }
+
+    /* Find new mappings for the given clients on the non-occupied cpus, which don't
+     * degrade any of them by more than they tolerate. The memory of the clients moves
+     * along in the given ledger. */
+    bool relocate(std::vector<Client*> victims, CPUList occupied, Ledger resources,
+            std::vector<std::pair<Client*, Mapping>>& plan)
+    {
+        /* Place the largest clients first, they have the fewest options. */
+        std::stable_sort(victims.begin(), victims.end(), [](const Client* a, const Client* b) {
+                return a->cpus().nr_cpus() > b->cpus().nr_cpus();
+        });
+
+        for (auto v : victims) {
+            const Mapping* best = nullptr;
+            resources.remove_resources(v->active_mapping);
+
+            auto candidates = tetris_mappings(filtered_mappings(*v), occupied);
+            for (const auto& m : candidates) {
+                if (v->comp.degradation(m, v->reference) > v->max_degradation + 1e-9 || !within_quota(*v, m, plan) ||
+                        !resources.fits_resources(m))
+                    continue;
+
+                if (!best || v->comp(m, *best))
+                    best = &m;
+            }
+
+            if (!best)
+                return false;
+
+            occupied |= best->cpus;
+            resources.add_resources(*best);
+            plan.emplace_back(v, *best);
+        }
+
+        return true;
+    }
+
+    double energy_of(const Mapping& m) const
+    {
+        auto it = m.characteristics_map.find(_config.budget_criteria);
+        return it != m.characteristics_map.end() ? it->second : 0;
+    }
+
+    /***
+     * Quotas of users and cgroups
+     ***/
+
+    /* Who runs a client. The credentials of its connection are trusted over the pid it sent. */
+    void identify(Client& c)
+    {
+        int pid, uid;
+        if (!platform->peer(c.connection->fd(), pid, uid))
+            return;
+
+        if (pid != c.pid) {
+            logger->warning(" * client claims pid %d, but connected from pid %d\n", c.pid, pid);
+            c.pid = pid;
+        }
+
+        c.uid = uid;
+        c.user = Quotas::user_name(uid);
+        c.cgroup = platform->cgroup(pid);
+
+        logger->info(" * user: %s (%d), cgroup: %s\n", c.user.c_str(), c.uid, c.cgroup.empty() ? "unknown" : c.cgroup.c_str());
+    }
+
+    /* Whether the given mapping of a client keeps the clients it shares the quota with within it.
+     * The clients in the plan count with their planned mappings. */
+    bool within(const Quota& q, const Client& c, const Mapping& m, const std::function<bool(const Client&)>& shares,
+            const std::vector<std::pair<Client*, Mapping>>& plan) const
+    {
+        int cpus = 0;
+        double energy = 0;
+        std::map<std::string, int> cluster_cpus;
+
+        auto add = [&](const Mapping& mapping) {
+            cpus += mapping.cpus.nr_cpus();
+            energy += energy_of(mapping);
+            for (const auto& cl : clusters)
+                cluster_cpus[cl.name] += (mapping.cpus & cl.cpus).nr_cpus();
+        };
+
+        add(m);
+        for (const auto& [fd, cl] : _clients) {
+            if (&cl == &c || !shares(cl))
+                continue;
+
+            auto planned = std::find_if(plan.begin(), plan.end(), [&cl](const auto& e) { return e.first == &cl; });
+            if (planned != plan.end())
+                add(planned->second);
+            else if (cl.state == Client::State::RUNNING)
+                add(cl.active_mapping);
+        }
+
+        if (q.cpus >= 0 && cpus > q.cpus)
+            return false;
+
+        for (const auto& [cluster, limit] : q.cluster_cpus) {
+            if (cluster_cpus[cluster] > limit)
+                return false;
+        }
+
+        return q.energy_share < 0 || _config.energy_budget <= 0 || energy <= q.energy_share * _config.energy_budget + 1e-9;
+    }
+
+    bool within_quota(const Client& c, const Mapping& m, const std::vector<std::pair<Client*, Mapping>>& plan = {}) const
+    {
+        if (_quotas.empty())
+            return true;
+
+        auto user = _quotas.user(c.uid, c.user);
+        if (user != nullptr && !within(*user, c, m, [&c](const Client& o) { return o.uid == c.uid; }, plan))
+            return false;
+
+        auto cgroup = _quotas.cgroup_of(c.cgroup);
+        if (!cgroup.empty() && !within(*_quotas.cgroup(cgroup), c, m,
+                    [&](const Client& o) { return _quotas.cgroup_of(o.cgroup) == cgroup; }, plan))
+            return false;
+
+        return true;
+    }
+
+    /* The energy of all running clients except the given one. */
+    double energy_total(const Client* except = nullptr) const
+    {
+        double result = 0;
+        for (const auto& [fd, cl] : _clients) {
+            if (&cl == except || cl.state != Client::State::RUNNING)
+                continue;
+
+            result += energy_of(cl.active_mapping);
+        }
+
+        return result;
+    }
+
+    /* Move running clients up to the given priority to cheaper mappings until the given
+     * amount of energy is saved. The least important clients are downgraded first. */
+    bool downgrade(double deficit, CPUList occupied, const Client* except, int max_priority, Ledger resources,
+            std::vector<std::pair<Client*, Mapping>>& plan)
+    {
+        std::vector<Client*> candidates;
+        for (auto& [fd, cl] : _clients) {
+            if (&cl == except || cl.state != Client::State::RUNNING || cl.priority > max_priority)
+                continue;
+
+            candidates.push_back(&cl);
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Client* a, const Client* b) {
+                return a->priority < b->priority;
+        });
+
+        for (auto v : candidates) {
+            if (deficit <= 0)
+                break;
+
+            double current = energy_of(v->active_mapping);
+            resources.remove_resources(v->active_mapping);
+
+            /* The client may use its own cpus as well as all the free ones. */
+            CPUList others = occupied;
+            for (auto cpu : v->cpus().cpulist(num_cpus))
+                others.clear(cpu);
+
+            const Mapping* best = nullptr;
+            auto options = tetris_mappings(filtered_mappings(*v), others);
+            for (const auto& m : options) {
+                double saving = current - energy_of(m);
+                if (saving <= 0 || !within_quota(*v, m, plan) || !resources.fits_resources(m))
+                    continue;
+
+                if (!best) {
+                    best = &m;
+                    continue;
+                }
+
+                /* Prefer the best mapping that covers the deficit, otherwise save as much as possible. */
+                double best_saving = current - energy_of(*best);
+                bool covers = saving >= deficit, best_covers = best_saving >= deficit;
+                if ((covers && !best_covers) || (covers && best_covers && v->comp(m, *best)) ||
+                        (!covers && !best_covers && saving > best_saving))
+                    best = &m;
+            }
+
+            if (!best) {
+                resources.add_resources(v->active_mapping);
+                continue;
+            }
+
+            deficit -= current - energy_of(*best);
+            occupied = others | best->cpus;
+            resources.add_resources(*best);
+            plan.emplace_back(v, *best);
+        }
+
+        return deficit <= 0;
+    }
+
+    Mapping select_within_budget(Client& c)
+    {
+        /* Let the policy choose among the mappings for which enough energy can be saved by
+         * downgrading running clients which are not more important. */
+        auto candidates = tetris_mappings(filtered_mappings(c), occupied(c));
+        std::stable_sort(candidates.begin(), candidates.end(), [&c](const Mapping& a, const Mapping& b) {
+                return c.comp(a, b);
+        });
+
+        std::vector<Mapping> options;
+        std::vector<std::vector<std::pair<Client*, Mapping>>> plans;
+
+        auto resources = ledger(&c);
+        for (const auto& cand : candidates) {
+            if (!within_quota(c, cand) || !resources.fits_resources(cand))
+                continue;
+
+            double deficit = energy_total(&c) + energy_of(cand) - _config.energy_budget;
+
+            auto moved = resources;
+            moved.add_resources(cand);
+
+            std::vector<std::pair<Client*, Mapping>> plan;
+            if (!downgrade(deficit, occupied(c) | cand.cpus, &c, c.priority, moved, plan))
+                continue;
+
+            options.push_back(cand);
+            plans.push_back(plan);
+        }
+
+        int choice = policy_choice(c, options, resources);
+        if (choice < 0)
+            throw NoMappingError("Can't keep the energy budget for the client.");
+
+        const auto& plan = plans[choice];
+        logger->info("Downgrade %i client(s) to keep the energy budget for client '%s' [%d]\n", plan.size(),
+                c.exec.c_str(), c.pid);
+
+        for (auto& [v, m] : plan) {
+            logger->info(" * client '%s' [%d] saves %.0f\n", v->exec.c_str(), v->pid,
+                    energy_of(v->active_mapping) - energy_of(m));
+            apply_mapping(*v, m);
+        }
+
+        _stats.budget_downgrades += plan.size();
+
+        return options[choice];
+    }
+
+    void enforce_budget()
+    {
+        if (_config.energy_budget <= 0)
+            return;
+
+        double deficit = energy_total() - _config.energy_budget;
+        if (deficit <= 0)
+            return;
+
+        CPUList occupied = _blocked_cpus;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::RUNNING)
+                occupied |= cl.cpus();
+        }
+
+        std::vector<std::pair<Client*, Mapping>> plan;
+        if (!downgrade(deficit, occupied, nullptr, std::numeric_limits<int>::max(), ledger(), plan))
+            logger->warning("Can't get below the energy budget (%.0f over)\n", deficit);
+
+        for (auto& [v, m] : plan) {
+            logger->info("Downgrade client '%s' [%d] to keep the energy budget\n", v->exec.c_str(), v->pid);
+            apply_mapping(*v, m);
+        }
+
+        _stats.budget_downgrades += plan.size();
+    }
+
+    void print_budget(std::ostream& os)
+    {
+        os << "Energy budget (" << _config.budget_criteria << "):" << std::endl;
+        if (_config.energy_budget <= 0)
+            os << "-> budget: none" << std::endl;
+        else
+            os << "-> budget: " << std::setprecision(0) << std::fixed << _config.energy_budget << std::endl;
+
+        double total = energy_total();
+        os << "-> used: " << std::setprecision(0) << std::fixed << total;
+        if (_config.energy_budget > 0)
+            os << " (" << std::setprecision(1) << 100 * total / _config.energy_budget << "%)";
+        os << std::endl;
+
+        os << "-> downgrades: " << _stats.budget_downgrades << std::endl;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state != Client::State::RUNNING)
+                continue;
+
+            os << "--> '" << cl.exec << "' [" << cl.pid << "] (ID: " << fd << "): " << std::setprecision(0) << std::fixed
+               << energy_of(cl.active_mapping) << " (mapping " << cl.active_mapping.name << ")" << std::endl;
+        }
+    }
+
+    Mapping select_with_preemption(Client& c)
+    {
+        /* Without making room the client would get this mapping. */
+        Mapping fallback;
+        bool has_fallback = true;
+        try {
+            fallback = select_best_mapping(c);
+        } catch (NoMappingError&) {
+            has_fallback = false;
+        }
+
+        /* Saving energy elsewhere is preferred over pushing clients aside. */
+        if (!has_fallback && _config.energy_budget > 0) {
+            try {
+                return select_within_budget(c);
+            } catch (NoMappingError&) {
+                /* Try to make room instead. */
+            }
+        }
+
+        /* Only running clients with lower priority can be pushed aside. */
+        CPUList hard_occupied = _blocked_cpus;
+        bool any_lower = false;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.pid == c.pid || cl.state != Client::State::RUNNING)
+                continue;
+
+            if (cl.priority >= c.priority)
+                hard_occupied |= cl.cpus();
+            else
+                any_lower = true;
+        }
+
+        if (!any_lower) {
+            if (has_fallback)
+                return fallback;
+
+            throw NoMappingError("Can't find a proper TETRiS mapping for the client.");
+        }
+
+        auto candidates = tetris_mappings(filtered_mappings(c), hard_occupied);
+        std::stable_sort(candidates.begin(), candidates.end(), [&c](const Mapping& a, const Mapping& b) {
+                return c.comp(a, b);
+        });
+
+        std::vector<Mapping> options;
+        std::vector<std::vector<std::pair<Client*, Mapping>>> plans;
+
+        auto resources = ledger(&c);
+        for (const auto& cand : candidates) {
+            if (has_fallback && !c.comp(cand, fallback))
+                break;
+
+            if (!within_quota(c, cand) || !resources.fits_resources(cand))
+                continue;
+
+            std::vector<Client*> victims;
+            CPUList occupied = hard_occupied | cand.cpus;
+            for (auto& [fd, cl] : _clients) {
+                if (cl.pid == c.pid || cl.state != Client::State::RUNNING || cl.priority >= c.priority)
+                    continue;
+
+                if (cl.cpus().overlaps_with(cand.cpus))
+                    victims.push_back(&cl);
+                else
+                    occupied |= cl.cpus();
+            }
+
+            auto moved = resources;
+            moved.add_resources(cand);
+
+            std::vector<std::pair<Client*, Mapping>> plan;
+            if (!relocate(victims, occupied, moved, plan))
+                continue;
+
+            if (_config.energy_budget > 0) {
+                double total = energy_total(&c) + energy_of(cand);
+                for (auto& [v, m] : plan)
+                    total += energy_of(m) - energy_of(v->active_mapping);
+
+                if (total > _config.energy_budget)
+                    continue;
+            }
+
+            options.push_back(cand);
+            plans.push_back(plan);
+        }
+
+        /* The policy may as well prefer the mapping which pushes nobody aside. */
+        if (has_fallback) {
+            options.push_back(fallback);
+            plans.emplace_back();
+        }
+
+        int choice = policy_choice(c, options, resources);
+        if (choice < 0 || (has_fallback && static_cast<size_t>(choice) == options.size() - 1)) {
+            if (has_fallback)
+                return fallback;
+
+            throw NoMappingError("Can't find a proper TETRiS mapping for the client.");
+        }
+
+        const auto& plan = plans[choice];
+        logger->info("Make room for client '%s' [%d] (priority %d) by remapping %i client(s)\n",
+                c.exec.c_str(), c.pid, c.priority, plan.size());
+
+        for (auto& [v, m] : plan) {
+            logger->info(" * client '%s' [%d] (priority %d) degrades by %.1f%%\n", v->exec.c_str(), v->pid,
+                    v->priority, 100 * v->comp.degradation(m, v->reference));
+            apply_mapping(*v, m);
+        }
+
+        ++_stats.preemptions;
+        _stats.preempted_clients += plan.size();
+
+        return options[choice];
+    }
+
+    void set_reference(Client& c)
+    {
+        try {
+            c.reference = c.active_mapping.characteristic(c.comp.criteria());
+        } catch (std::runtime_error&) {
+            c.reference = 0;
+        }
+    }
+
+    Mapping use_preferred_mapping(Client& c, const std::string& preferred_mapping_name)
+    {
+        logger->info("Use preferred mapping '%s' for '%s' [%d]\n", preferred_mapping_name.c_str(), c.exec.c_str(), c.pid);
+
+        auto it = std::find_if(c.mappings.begin(), c.mappings.end(), [&](const auto& m) { return m.name == preferred_mapping_name; });
+        if (it == c.mappings.end()) {
+            logger->info("Couldn't find preferred mapping\n");
+            return select_best_mapping(c);
+        } else if (!within_quota(c, *it)) {
+            logger->info("The preferred mapping exceeds the quotas\n");
+            return select_best_mapping(c);
+        }
+
+        return *it;
+    }
+
+    /* The nodes of a packing dimension with their capacity. */
+    static std::vector<std::pair<CPUList, double>> nodes(const std::map<std::string, double>& capacity)
+    {
+        std::vector<std::pair<CPUList, double>> result;
+        for (const auto& [name, cap] : capacity) {
+            if (name.empty()) {
+                CPUList all;
+                for (int cpu = 0; cpu < num_cpus; ++cpu)
+                    all.set(cpu);
+
+                result.emplace_back(all, cap);
+                continue;
+            }
+
+            for (const auto& cl : clusters) {
+                if (cl.name == name)
+                    result.emplace_back(cl.cpus, cap);
+            }
+        }
+
+        return result;
+    }
+
+    /* The cpu usage of all running clients and the memory of all placed clients, except
+     * the given one. */
+    Ledger ledger(const Client* except = nullptr) const
+    {
+        Ledger result{_config.colocate_limit};
+        result.block(_blocked_cpus);
+
+        for (const auto& [criteria, capacity] : {std::make_pair(_config.memory_criteria, _config.memory_capacity),
+                std::make_pair(_config.bandwidth_criteria, _config.bandwidth_capacity)}) {
+            if (!capacity.empty())
+                result.add_dimension(criteria, nodes(capacity));
+        }
+
+        for (const auto& [name, cl] : _clients) {
+            if (except != nullptr && cl.pid == except->pid)
+                continue;
+
+            /* Clients in a time slot keep their memory while they are stopped. */
+            if (cl.state == Client::State::RUNNING)
+                result.add(cl.active_mapping, cl.exclusive);
+            else if (cl.state == Client::State::SLICED)
+                result.add_resources(cl.active_mapping);
+        }
+
+        return result;
+    }
+
+    /* The cpus that are not available for a new mapping of the given client. */
+    CPUList occupied(const Client& c) const
+    {
+        CPUList result = _blocked_cpus;
+        for (const auto& [name, cl] : _clients) {
+            if (cl.pid == c.pid || cl.state != Client::State::RUNNING)
+                continue;
+
+            result |= cl.cpus();
+        }
+
+        return result;
+    }
+
+    CPUList used_cpus() const
+    {
+        CPUList used;
+        for (const auto& [name, cl] : _clients)
+            used |= cl.cpus();
+
+        return used;
+    }
+
+    CPUList free_cpus() const
+    {
+        CPUList free;
+        for (int cpu = 0; cpu < num_cpus; ++cpu)
+            free.set(cpu);
+
+        CPUList taken = used_cpus() | _blocked_cpus;
+        for (auto cpu : taken.cpulist(num_cpus))
+            free.clear(cpu);
+
+        return free;
+    }
+
+    static int clusters_in_use(const CPUList& used)
+    {
+        int result = 0;
+        for (const auto& cl : clusters) {
+            if (cl.cpus.overlaps_with(used))
+                ++result;
+        }
+
+        return result;
+    }
+
+    static int largest_free_region(const CPUList& taken)
+    {
+        int result = 0, cur = 0;
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            if (taken.overlaps_with(CPUList{cpu})) {
+                cur = 0;
+            } else {
+                ++cur;
+                result = std::max(result, cur);
+            }
+        }
+
+        return result;
+    }
+
+    void apply_mapping(Client& c, const Mapping& m)
+    {
+        /* Parked CPUs must be brought back online before threads can be moved there. */
+        if (_parking.enabled()) {
+            auto needed = m.cpus & _parking.parked();
+            if (needed.nr_cpus() != 0) {
+                auto unparked = _parking.unpark(needed);
+                logger->info(" * unparked cpu(s) %s\n", string_util::join(unparked.cpulist(num_cpus), ",").c_str());
+
+                if (unparked != needed)
+                    logger->warning("Failed to unpark cpu(s) %s\n", string_util::join(needed.cpulist(num_cpus), ",").c_str());
+            }
+        }
+
+        if (!c.run_mapping.empty() && m.name != c.run_mapping)
+            c.run_mapping.clear();
+
+        c.update_mapping(m);
+        ++_generation;
+
+        if (!interference_enabled())
+            return;
+
+        /* Remember who ran next to whom, and what that is expected to cost. */
+        c.slowdown = slowdown(c, m);
+        if (c.slowdown > 1) {
+            ++_stats.interfered;
+            _stats.max_slowdown = std::max(_stats.max_slowdown, c.slowdown);
+        }
+        _stats.total_slowdown += c.slowdown;
+
+        for (auto& [fd, cl] : _clients) {
+            if (&cl != &c && cl.state == Client::State::RUNNING && !cl.run_mapping.empty() && share_cluster(m.cpus, cl.cpus()))
+                cl.run_neighbours.insert(c.exec);
+        }
+    }
+
+    void compact()
+    {
+        /* Try to move all running clients onto equivalent placements so that they occupy
+         * as few clusters as possible. Largest clients are placed first. */
+        std::vector<Client*> running;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::RUNNING)
+                running.push_back(&cl);
+        }
+
+        if (running.empty())
+            return;
+
+        std::stable_sort(running.begin(), running.end(), [](const Client* a, const Client* b) {
+                return a->cpus().nr_cpus() > b->cpus().nr_cpus();
+        });
+
+        logger->debug("Compacting %i client(s)\n", running.size());
+
+        CPUList occupied = _blocked_cpus;
+        CPUList used;
+        auto resources = ledger();
+        std::vector<std::pair<Client*, Mapping>> plan;
+
+        for (auto cl : running) {
+            resources.remove_resources(cl->active_mapping);
+
+            std::vector<Mapping> candidates;
+            try {
+                candidates = cl->active_mapping.equivalent_mappings();
+            } catch (std::runtime_error&) {
+                candidates = {cl->active_mapping};
+            }
+
+            const Mapping* best = nullptr;
+            std::tuple<int, int, int, bool> best_key;
+
+            for (const auto& m : candidates) {
+                if (occupied.overlaps_with(m.cpus) || !resources.fits_resources(m))
+                    continue;
+
+                /* Prefer placements which don't touch new clusters, span few clusters and
+                 * sit at the low end of the clusters to keep the free region contiguous. */
+                int cpu_sum = 0;
+                for (auto cpu : m.cpus.cpulist(num_cpus))
+                    cpu_sum += cpu;
+
+                auto key = std::make_tuple(clusters_in_use(used | m.cpus) - clusters_in_use(used),
+                        clusters_in_use(m.cpus), cpu_sum, m.cpus != cl->cpus());
+
+                if (!best || key < best_key) {
+                    best = &m;
+                    best_key = key;
+                }
+            }
+
+            if (!best) {
+                logger->debug(" * No compact placement found for client '%s' [%d]\n", cl->exec.c_str(), cl->pid);
+                return;
+            }
+
+            occupied |= best->cpus;
+            used |= best->cpus;
+            resources.add_resources(*best);
+            plan.emplace_back(cl, *best);
+        }
+
+        CPUList old_used = used_cpus();
+        auto old_metric = std::make_pair(clusters_in_use(old_used), -largest_free_region(old_used | _blocked_cpus));
+        auto new_metric = std::make_pair(clusters_in_use(used), -largest_free_region(used | _blocked_cpus));
+
+        if (!(new_metric < old_metric)) {
+            logger->debug(" * Current placement is already compact\n");
+            return;
+        }
+
+        logger->info("Compact clients from %i to %i cluster(s)\n", old_metric.first, new_metric.first);
+
+        /* The plan itself is free of conflicts, so old and new placements only overlap
+         * briefly while the clients are moved one after the other. */
+        for (auto& [cl, m] : plan)
+            apply_mapping(*cl, m);
+    }
+
+    /* The best value of the client's compare criteria in its database. */
+    void set_best_value(Client& c)
+    {
+        c.best_value = 0;
+
+        const Mapping* best = nullptr;
+        auto mappings = filtered_mappings(c);
+        for (const auto& m : mappings) {
+            try {
+                if (!best || c.comp(m, *best))
+                    best = &m;
+            } catch (std::runtime_error&) {
+                /* Mappings without the characteristic don't count. */
+            }
+        }
+
+        if (best)
+            c.best_value = best->characteristic(c.comp.criteria());
+    }
+
+    /* How good the mapping is for the client compared to its best possible mapping, between
+     * 0 and 1. Clients without a known best value are always well off. */
+    static double quality(const Client& c, const Mapping& m)
+    {
+        if (c.best_value == 0)
+            return 1;
+
+        double value;
+        try {
+            value = m.characteristic(c.comp.criteria());
+        } catch (std::runtime_error&) {
+            return 0;
+        }
+
+        double q = c.comp.more_is_better() ? value / c.best_value : c.best_value / value;
+        return std::isfinite(q) ? std::max(0.0, std::min(1.0, q)) : 0;
+    }
+
+    static double quality(const Client& c)
+    {
+        return quality(c, c.active_mapping);
+    }
+
+    /* Find new mappings for the clients on the non-occupied cpus which keep each of them
+     * above the given quality. The worst off clients choose first, so that the best off
+     * ones take the downgrades. The memory of the clients moves along in the given ledger. */
+    bool relocate_above(std::vector<Client*> victims, CPUList occupied, double floor, Ledger resources,
+            std::vector<std::pair<Client*, Mapping>>& plan)
+    {
+        std::stable_sort(victims.begin(), victims.end(), [](const Client* a, const Client* b) {
+                return quality(*a) < quality(*b);
+        });
+
+        for (auto v : victims) {
+            const Mapping* best = nullptr;
+            resources.remove_resources(v->active_mapping);
+
+            auto candidates = tetris_mappings(filtered_mappings(*v), occupied);
+            for (const auto& m : candidates) {
+                if (quality(*v, m) <= floor + 1e-9 || !within_quota(*v, m, plan) || !resources.fits_resources(m))
+                    continue;
+
+                if (!best || v->comp(m, *best))
+                    best = &m;
+            }
+
+            if (!best)
+                return false;
+
+            occupied |= best->cpus;
+            resources.add_resources(*best);
+            plan.emplace_back(v, *best);
+        }
+
+        return true;
+    }
+
+    /* Raise the quality of the worst off client by moving the clients in the way. Returns
+     * false if that isn't possible without someone else dropping to its quality. */
+    bool improve_worst(Client& w)
+    {
+        double floor = quality(w);
+
+        std::vector<std::pair<Client*, Mapping>> best_plan;
+        double best_min = floor;
+
+        /* Clients more important than the worst off one are not moved for it, nor are the
+         * members of a group, which were placed together. */
+        CPUList hard_occupied = _blocked_cpus;
+        for (const auto& [fd, cl] : _clients) {
+            if (&cl != &w && cl.state == Client::State::RUNNING && (cl.priority > w.priority || !cl.group.empty()))
+                hard_occupied |= cl.cpus();
+        }
+
+        auto resources = ledger(&w);
+
+        auto candidates = tetris_mappings(filtered_mappings(w), hard_occupied);
+        for (const auto& cand : candidates) {
+            double q = quality(w, cand);
+            if (q <= best_min + 1e-9 || !resources.fits_resources(cand))
+                continue;
+
+            std::vector<Client*> victims;
+            CPUList occupied = hard_occupied | cand.cpus;
+            for (auto& [fd, cl] : _clients) {
+                if (&cl == &w || cl.state != Client::State::RUNNING || cl.priority > w.priority || !cl.group.empty())
+                    continue;
+
+                if (cl.cpus().overlaps_with(cand.cpus))
+                    victims.push_back(&cl);
+                else
+                    occupied |= cl.cpus();
+            }
+
+            auto moved = resources;
+            moved.add_resources(cand);
+
+            std::vector<std::pair<Client*, Mapping>> plan;
+            if (!relocate_above(victims, occupied, floor, moved, plan) || !within_quota(w, cand, plan))
+                continue;
+
+            plan.emplace_back(&w, cand);
+
+            if (_config.energy_budget > 0) {
+                double total = energy_total();
+                for (auto& [cl, m] : plan)
+                    total += energy_of(m) - energy_of(cl->active_mapping);
+
+                if (total > _config.energy_budget)
+                    continue;
+            }
+
+            /* Take the plan which leaves the moved clients with the best minimum. */
+            double min = q;
+            for (auto& [cl, m] : plan)
+                min = std::min(min, quality(*cl, m));
+
+            if (min > best_min + 1e-9) {
+                best_min = min;
+                best_plan = plan;
+            }
+        }
+
+        if (best_plan.empty())
+            return false;
+
+        logger->info("Rebalance for client '%s' [%d] from quality %.2f to %.2f by remapping %i client(s)\n",
+                w.exec.c_str(), w.pid, floor, best_min, best_plan.size() - 1);
+
+        /* The plan places the client last, after everybody in its way moved. */
+        for (auto& [cl, m] : best_plan) {
+            logger->info(" * client '%s' [%d]: %s -> %s (quality %.2f -> %.2f)\n", cl->exec.c_str(), cl->pid,
+                    cl->active_mapping.name.c_str(), m.name.c_str(), quality(*cl), quality(*cl, m));
+            apply_mapping(*cl, m);
+            set_reference(*cl);
+        }
+
+        ++_stats.fair_rebalances;
+        _stats.fair_moves += best_plan.size();
+
+        return true;
+    }
+
+    /* Maximize the minimum quality of the running clients. */
+    void balance()
+    {
+        if (!_config.fair)
+            return;
+
+        /* Every round raises the minimum or reduces the number of clients at it. Groups stay
+         * where they were placed together. */
+        for (size_t round = 0; round < 2 * _clients.size(); ++round) {
+            Client* worst = nullptr;
+            for (auto& [fd, cl] : _clients) {
+                if (cl.state == Client::State::RUNNING && cl.group.empty() && (!worst || quality(cl) < quality(*worst)))
+                    worst = &cl;
+            }
+
+            if (!worst || quality(*worst) >= 1 - 1e-9 || !improve_worst(*worst))
+                break;
+        }
+    }
+
+    /* Move running clients to better mappings after cpus became free. Clients with higher
+     * priority go first, and each client is moved at most once per upgrade interval. */
+    void upgrade_clients()
+    {
+        if (!_config.upgrade)
+            return;
+
+        std::vector<Client*> running;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state != Client::State::RUNNING)
+                continue;
+
+            if (cl.upgrades != 0 && seconds_since(cl.last_upgrade) < _config.upgrade_interval_s)
+                continue;
+
+            running.push_back(&cl);
+        }
+
+        std::stable_sort(running.begin(), running.end(), [](const Client* a, const Client* b) {
+                return a->priority > b->priority;
+        });
+
+        for (auto cl : running) {
+            Mapping m;
+            double current;
+            try {
+                m = select_best_mapping(*cl);
+                current = cl->active_mapping.characteristic(cl->comp.criteria());
+            } catch (std::runtime_error&) {
+                continue;
+            }
+
+            double gain = -cl->comp.degradation(m, current);
+            if (gain <= _config.upgrade_hysteresis)
+                continue;
+
+            logger->info("Upgrade client '%s' [%d] from %s to %s (%.1f%% better)\n", cl->exec.c_str(), cl->pid,
+                    cl->active_mapping.name.c_str(), m.name.c_str(), 100 * gain);
+
+            apply_mapping(*cl, m);
+            set_reference(*cl);
+
+            cl->last_upgrade = platform->now();
+            ++cl->upgrades;
+
+            ++_stats.upgrades;
+            _stats.upgrade_gain += gain;
+        }
+    }
+
+    std::vector<Client*> waiting_clients()
+    {
+        std::vector<Client*> result;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::WAITING)
+                result.push_back(&cl);
+        }
+
+        return result;
+    }
+
+    std::vector<Client*> queued_clients()
+    {
+        std::vector<Client*> result;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::WAITING || cl.state == Client::State::SUSPENDED)
+                result.push_back(&cl);
+        }
+
+        return result;
+    }
+
+    bool acknowledge(Client& c, bool managed)
+    {
+        TetrisData ack;
+        ack.op = TetrisData::NEW_CLIENT_ACK;
+        ack.new_client_ack_data.id = c.id;
+        ack.new_client_ack_data.managed = managed;
+
+        if (c.connection->write(ack) != Connection::OutState::DONE) {
+            logger->error("Failed to acknowledge the new-client message\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    /* Forget a client which runs on its own from now on. Its connection closes with it, so
+     * this is a disconnect as far as the journal is concerned. */
+    void release(int fd)
+    {
+        _journal.record(Journal::Event::DISCONNECT, fd, platform->now());
+        _clients.erase(fd);
+    }
+
+    void suspend(Client& c)
+    {
+        logger->info("Suspend client '%s' [%d] until a mapping fits\n", c.exec.c_str(), c.pid);
+
+        if (!platform->send_signal(c.pid, SIGSTOP))
+            logger->warning("Failed to stop client '%s' [%d]: %s\n", c.exec.c_str(), c.pid, strerror(errno));
+
+        c.state = Client::State::SUSPENDED;
+        c.waiting_since = platform->now();
+
+        ++_stats.suspended;
+        _stats.max_queue_length = std::max(_stats.max_queue_length, queued_clients().size());
+    }
+
+    void resume(Client& c)
+    {
+        if (!platform->send_signal(c.pid, SIGCONT))
+            logger->warning("Failed to continue client '%s' [%d]: %s\n", c.exec.c_str(), c.pid, strerror(errno));
+    }
+
+    Mapping leftover_mapping() const
+    {
+        /* Waiting clients share all cpus which are not used by running clients. If there
+         * are none left, they have to share with the running ones. */
+        Mapping leftover;
+        leftover.name = "leftover";
+
+        CPUList taken = _blocked_cpus;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::RUNNING)
+                taken |= cl.cpus();
+        }
+
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            if (!taken.overlaps_with(CPUList{cpu}))
+                leftover.cpus.set(cpu);
+        }
+
+        if (leftover.cpus.nr_cpus() == 0) {
+            for (int cpu = 0; cpu < num_cpus; ++cpu) {
+                if (!_blocked_cpus.overlaps_with(CPUList{cpu}))
+                    leftover.cpus.set(cpu);
+            }
+        }
+
+        return leftover;
+    }
+
+    void enqueue(Client& c)
+    {
+        logger->info("Queue client '%s' [%d] until a mapping fits\n", c.exec.c_str(), c.pid);
+
+        c.state = Client::State::WAITING;
+        c.waiting_since = platform->now();
+        apply_mapping(c, leftover_mapping());
+
+        ++_stats.queued;
+        _stats.max_queue_length = std::max(_stats.max_queue_length, queued_clients().size());
+    }
+
+    void refresh_waiting()
+    {
+        auto leftover = leftover_mapping();
+
+        for (auto cl : waiting_clients())
+            apply_mapping(*cl, leftover);
+    }
+
+    double predicted_execution_time(Client& c)
+    {
+        double result = std::numeric_limits<double>::infinity();
+
+        for (const auto& m : c.mappings) {
+            if (!c.filter(m))
+                continue;
+
+            try {
+                result = std::min(result, m.characteristic("executionTime"));
+            } catch (std::runtime_error&) {
+                /* This mapping doesn't predict an execution time. */
+            }
+        }
+
+        return result;
+    }
+
+    void admit(Client& c, const Mapping& m)
+    {
+        double wait = seconds_since(c.waiting_since);
+
+        logger->info("Admit queued client '%s' [%d] after %.3f s\n", c.exec.c_str(), c.pid, wait);
+
+        auto previous = c.state;
+        c.state = Client::State::RUNNING;
+        apply_mapping(c, m);
+        set_reference(c);
+
+        if (previous == Client::State::SUSPENDED) {
+            /* The whole process only continues once all of its tasks are on the mapping. */
+            c.new_thread("@main", c.pid);
+            c.restrict_tasks();
+            acknowledge(c, true);
+            resume(c);
+        }
+
+        ++_stats.admitted_from_queue;
+        _stats.total_wait_s += wait;
+        _stats.max_wait_s = std::max(_stats.max_wait_s, wait);
+    }
+
+    void admit_waiting()
+    {
+        auto queue = queued_clients();
+        if (queue.empty())
+            return;
+
+        logger->debug("Try to admit %i queued client(s) (%s)\n", queue.size(), queue_order_name(_config.queue_order).c_str());
+
+        if (_config.queue_order == QueueOrder::BEST_FIT) {
+            /* Always admit the client whose mapping leaves the fewest cpus unused. */
+            while (!queue.empty()) {
+                auto best = queue.end();
+                Mapping best_mapping;
+
+                for (auto it = queue.begin(); it != queue.end(); ++it) {
+                    try {
+                        auto m = select_best_mapping(**it);
+                        if (best == queue.end() || m.cpus.nr_cpus() > best_mapping.cpus.nr_cpus()) {
+                            best = it;
+                            best_mapping = m;
+                        }
+                    } catch (NoMappingError&) {
+                        /* This one still doesn't fit. */
+                    }
+                }
+
+                if (best == queue.end())
+                    break;
+
+                admit(**best, best_mapping);
+                queue.erase(best);
+            }
+        } else {
+            if (_config.queue_order == QueueOrder::SHORTEST_FIRST) {
+                std::map<Client*, double> predicted;
+                for (auto cl : queue)
+                    predicted[cl] = predicted_execution_time(*cl);
+
+                std::stable_sort(queue.begin(), queue.end(), [&](Client* a, Client* b) {
+                        return predicted[a] < predicted[b];
+                });
+            } else {
+                std::stable_sort(queue.begin(), queue.end(), [](Client* a, Client* b) {
+                        return a->waiting_since < b->waiting_since;
+                });
+            }
+
+            for (auto cl : queue) {
+                try {
+                    admit(*cl, select_best_mapping(*cl));
+                } catch (NoMappingError&) {
+                    /* This one still doesn't fit. */
+                }
+            }
+        }
+
+        refresh_waiting();
+    }
+
+    CPUList headroom_for(const Client& c) const
+    {
+        /* Clients which are not more important than a likely newcomer shouldn't take the
+         * cpus that were set aside for it. */
+        CPUList result;
+        if (_probing)
+            return result;
+
+        for (const auto& [exec, p] : _predictions) {
+            if (p.likely && p.has_mapping && exec != c.exec && p.priority >= c.priority)
+                result |= p.mapping.cpus;
+        }
+
+        return result;
+    }
+
+    void record_arrival(const Client& c)
+    {
+        ++_stats.arrivals;
+
+        if (!_config.predict)
+            return;
+
+        auto& p = _predictions[c.exec];
+        p.history.record(platform->now());
+        p.priority = c.priority;
+        p.dynamic_client = c.dynamic_client;
+        p.comp = c.comp;
+        p.filter = c.filter;
+    }
+
+    bool use_prediction(const Client& c, Mapping& m)
+    {
+        if (!_config.predict)
+            return false;
+
+        auto it = _predictions.find(c.exec);
+        if (it == _predictions.end() || !it->second.likely)
+            return false;
+
+        auto& p = it->second;
+        ++_stats.predicted_arrivals;
+
+        /* The precomputed mapping is only valid if nothing changed in the meantime. It was
+         * searched for without a user, so the quotas are only checked now. */
+        if (!p.has_mapping || p.generation != _generation || p.dynamic_client != c.dynamic_client ||
+                p.comp.repr() != c.comp.repr() || p.filter.repr() != c.filter.repr() || !within_quota(c, p.mapping))
+            return false;
+
+        logger->info("Use precomputed mapping for '%s' [%d]\n", c.exec.c_str(), c.pid);
+
+        m = p.mapping;
+        p.has_mapping = false;
+
+        ++_stats.prediction_hits;
+        _stats.prediction_saved_s += p.search_s;
+
+        return true;
+    }
+
+    void refresh_predictions()
+    {
+        if (!_config.predict)
+            return;
+
+        auto now = platform->now();
+
+        std::vector<std::pair<double, std::string>> likely;
+        bool changed = false;
+        for (auto& [exec, p] : _predictions) {
+            double prob = p.history.probability(now, _config.predict_horizon_s);
+            bool is_likely = prob >= _config.predict_threshold && _mappings.find(exec) != _mappings.end();
+
+            if (is_likely != p.likely)
+                changed = true;
+            if (is_likely && (!p.has_mapping || p.generation != _generation))
+                changed = true;
+
+            p.likely = is_likely;
+            if (is_likely)
+                likely.emplace_back(prob, exec);
+            else
+                p.has_mapping = false;
+        }
+
+        if (!changed)
+            return;
+
+        /* Precompute the mappings of the most likely newcomers first. Each one keeps its
+         * cpus as headroom for the ones that follow. */
+        std::sort(likely.begin(), likely.end(), std::greater<>{});
+
+        _probing = true;
+
+        CPUList reserved;
+        for (const auto& [prob, exec] : likely) {
+            auto& p = _predictions.at(exec);
+
+            Client probe{-1, nullptr};
+            probe.exec = exec;
+            probe.dynamic_client = p.dynamic_client;
+            probe.mappings = _mappings.at(exec);
+            probe.comp = p.comp;
+            probe.filter = p.filter;
+            probe.priority = p.priority;
+
+            auto start = Clock::now();
+            try {
+                p.mapping = select_best_mapping(probe, reserved);
+                p.has_mapping = true;
+                reserved |= p.mapping.cpus;
+
+                logger->debug("Precomputed mapping %s for '%s' (arrival probability %.2f)\n", p.mapping.name.c_str(),
+                        exec.c_str(), prob);
+            } catch (NoMappingError&) {
+                p.has_mapping = false;
+            }
+            p.search_s = elapsed_since(start);
+            p.generation = _generation;
+        }
+
+        _probing = false;
+    }
+
+    /* Place a registered client and add its main thread. Returns true if the client is
+     * acknowledged later on, throws NoMappingError if it can't be managed at all. */
+    bool place_new_client(Client& c, const std::string& preferred_mapping, const Mapping* planned = nullptr)
+    {
+        bool deferred = false;
+
+        try {
+            /* Jointly planned mappings only fit the memory and the quotas each on its own, and
+             * moves in between may have used up the energy budget. */
+            if (planned != nullptr && (!ledger(&c).fits_resources(*planned) || !within_quota(c, *planned) ||
+                        (_config.energy_budget > 0 && energy_total(&c) + energy_of(*planned) > _config.energy_budget + 1e-9)))
+                planned = nullptr;
+
+            if (planned != nullptr) {
+                apply_mapping(c, *planned);
+            } else if (!preferred_mapping.empty()) {
+                apply_mapping(c, use_preferred_mapping(c, preferred_mapping));
+            } else {
+                Mapping m;
+                if (!use_prediction(c, m))
+                    m = decide(c);
+
+                apply_mapping(c, m);
+            }
+
+            c.state = Client::State::RUNNING;
+            set_reference(c);
+            start_run(c);
+            refresh_waiting();
+            balance();
+
+            logger->info(" * mapping: %s (%.0f@%s) [%s]\n", c.active_mapping.name.c_str(),
+                    c.active_mapping.characteristic(c.comp.criteria()), c.comp.repr().c_str(),
+                    c.active_mapping.equivalence_class().name().c_str());
+        } catch (NoMappingError&) {
+            Mapping sliced;
+            if (c.admission == TetrisData::Admission::SUSPEND) {
+                suspend(c);
+                deferred = true;
+            } else if (_config.timeslice && slice(c, sliced)) {
+                apply_mapping(c, sliced);
+                c.state = Client::State::SLICED;
+                set_reference(c);
+                ++_stats.sliced;
+
+                logger->info(" * mapping: %s (time slot %d)\n", c.active_mapping.name.c_str(), c.slot);
+            } else if (_config.queue) {
+                enqueue(c);
+
+                logger->info(" * mapping: %s (waiting)\n", c.active_mapping.name.c_str());
+            } else {
+                throw;
+            }
+        }
+
+        if (!deferred) {
+            logger->info(" * thread placement: %s\n", c.dynamic_client ? "CFS" : "static");
+
+            /* Add the main thread to the client */
+            c.new_thread("@main", c.pid);
+        }
+
+        return deferred;
+    }
+
+    /***
+     * Evacuation of blocked cpus
+     ***/
+
+    struct Evacuation
+    {
+        std::vector<std::tuple<const Client*, Mapping, Mapping>> moved;    /* Client, old and new mapping */
+        std::vector<const Client*> stranded;
+        double              duration_s = 0;
+    };
+
+    /* Move the running clients off the given cpus. All new mappings are planned before any of
+     * them is applied, the largest clients first as they have the fewest options. The moves
+     * are bound by the same limits as those for preemption: the tolerated degradation, the
+     * quotas, the memory and the energy budget. Clients in time slots move to a slot with
+     * room for them. Clients which fit nowhere else are queued if the queue is enabled and
+     * keep their cpus otherwise. */
+    Evacuation evacuate(const CPUList& cpus)
+    {
+        auto start = Clock::now();
+        Evacuation result;
+
+        std::vector<Client*> victims, sliced;
+        CPUList occupied = _blocked_cpus | cpus;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SLICED && cl.cpus().overlaps_with(cpus))
+                sliced.push_back(&cl);
+
+            if (cl.state != Client::State::RUNNING)
+                continue;
+
+            if (cl.cpus().overlaps_with(cpus))
+                victims.push_back(&cl);
+            else
+                occupied |= cl.cpus();
+        }
+
+        if (victims.empty() && sliced.empty())
+            return result;
+
+        std::stable_sort(victims.begin(), victims.end(), [](const Client* a, const Client* b) {
+                return a->cpus().nr_cpus() > b->cpus().nr_cpus();
+        });
+
+        /* Without a queue, stranded clients keep their cpus, so the others are planned again
+         * around them. */
+        std::vector<std::pair<Client*, Mapping>> plan;
+        std::vector<Client*> stranded;
+        for (bool replan = true; replan;) {
+            replan = false;
+            plan.clear();
+
+            auto resources = ledger();
+            double energy = energy_total();
+            CPUList taken = occupied;
+            if (!_config.queue) {
+                for (auto v : stranded)
+                    taken |= v->cpus();
+            }
+
+            for (auto v : victims) {
+                if (std::find(stranded.begin(), stranded.end(), v) != stranded.end())
+                    continue;
+
+                const Mapping* best = nullptr;
+                double current = energy_of(v->active_mapping);
+                resources.remove_resources(v->active_mapping);
+
+                auto candidates = tetris_mappings(filtered_mappings(*v), taken);
+                for (const auto& m : candidates) {
+                    if (v->comp.degradation(m, v->reference) > v->max_degradation + 1e-9 || !within_quota(*v, m, plan) ||
+                            !resources.fits_resources(m))
+                        continue;
+
+                    /* Moves which cost more energy have to stay within the budget. */
+                    double more = energy_of(m) - current;
+                    if (_config.energy_budget > 0 && more > 0 && energy + more > _config.energy_budget + 1e-9)
+                        continue;
+
+                    if (!best || v->comp(m, *best))
+                        best = &m;
+                }
+
+                if (best) {
+                    taken |= best->cpus;
+                    energy += energy_of(*best) - current;
+                    resources.add_resources(*best);
+                    plan.emplace_back(v, *best);
+                } else {
+                    resources.add_resources(v->active_mapping);
+                    stranded.push_back(v);
+                    replan = !_config.queue;
+                }
+            }
+        }
+
+        logger->info("Evacuate cpu(s) %s: %i client(s) to move\n", string_util::join(cpus.cpulist(num_cpus), ",").c_str(),
+                victims.size() + sliced.size());
+
+        for (auto& [v, m] : plan) {
+            result.moved.emplace_back(v, v->active_mapping, m);
+            apply_mapping(*v, m);
+        }
+
+        /* Clients in time slots are placed again once the running clients moved. */
+        for (auto v : sliced) {
+            Mapping m;
+            int slot = v->slot;
+            if (slice(*v, m) && v->comp.degradation(m, v->reference) <= v->max_degradation + 1e-9) {
+                result.moved.emplace_back(v, v->active_mapping, m);
+                apply_mapping(*v, m);
+            } else {
+                v->slot = slot;
+                stranded.push_back(v);
+            }
+        }
+
+        for (auto v : stranded) {
+            if (_config.queue) {
+                /* Waiting clients run on the leftover cpus, even if their slot was stopped. */
+                if (v->stopped) {
+                    resume(*v);
+                    v->stopped = false;
+                }
+
+                v->slot = 0;
+                enqueue(*v);
+            } else {
+                logger->warning(" * client '%s' [%d] fits nowhere else and keeps cpu(s) %s\n", v->exec.c_str(), v->pid,
+                        string_util::join(v->cpus().cpulist(num_cpus), ",").c_str());
+            }
+
+            result.stranded.push_back(v);
+        }
+
+        refresh_waiting();
+        if (!sliced.empty()) {
+            compact_slots();
+            enforce_slots();
+        }
+
+        result.duration_s = elapsed_since(start);
+
+        ++_stats.evacuations;
+        _stats.evacuated_clients += result.moved.size();
+        _stats.stranded_clients += stranded.size();
+        _stats.evacuation_s += result.duration_s;
+        _stats.max_evacuation_s = std::max(_stats.max_evacuation_s, result.duration_s);
+
+        logger->info(" * moved %i client(s) in %.3f ms\n", result.moved.size(), 1e3 * result.duration_s);
+
+        return result;
+    }
+
+    static std::string evacuation_repr(const Evacuation& e)
+    {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3)
+           << "Moved " << e.moved.size() << " client(s) in " << 1e3 * e.duration_s << " ms" << std::endl;
+        for (const auto& [cl, from, to] : e.moved)
+            ss << " '" << cl->exec << "' [" << cl->pid << "]: " << from.name << " on "
+               << string_util::join(from.cpus.cpulist(num_cpus), ",") << " -> " << to.name << " on "
+               << string_util::join(to.cpus.cpulist(num_cpus), ",") << std::endl;
+        for (auto cl : e.stranded)
+            ss << " '" << cl->exec << "' [" << cl->pid << "]: "
+               << (cl->state == Client::State::WAITING ? "queued" : "fits nowhere else, kept") << std::endl;
+
+        return ss.str();
+    }
+
+    /***
+     * Reservations
+     ***/
+
+    static std::string control_string(const char* text, size_t size)
+    {
+        return string_util::strip(std::string{text, strnlen(text, size)});
+    }
+
+    /* Keep the blocked cpus in line with the manual blocks and the reservations. */
+    void update_blocked()
+    {
+        CPUList blocked = _blocked_manually;
+        for (const auto& [job, r] : _reservations)
+            blocked |= r.cpus;
+
+        bool released = (_blocked_cpus & blocked).nr_cpus() < _blocked_cpus.nr_cpus();
+        _blocked_cpus = blocked;
+
+        ++_generation;
+        admit_waiting();
+
+        if (released)
+            upgrade_clients();
+    }
+
+    /* Reserve cpus for a job. The cpus are kept free of new placements right away, clients
+     * which already ran there are moved away at the start. A job renews its reservation, and
+     * reservations of a lower priority make room. */
+    std::string reserve(const ControlData& data)
+    {
+        const auto& d = data.reserve_data;
+
+        auto job = control_string(d.job, sizeof(d.job));
+        if (job.empty())
+            throw std::runtime_error{"the reservation has no job name"};
+        if (d.start_s < 0 || d.ttl_s < 0)
+            throw std::runtime_error{"the start and the ttl can't be negative"};
+
+        /* Cpus which other jobs reserved with at least the same priority. */
+        CPUList held;
+        for (const auto& [other, r] : _reservations) {
+            if (other != job && r.priority >= d.priority)
+                held |= r.cpus;
+        }
+
+        CPUList cpus{d.cpus};
+        if (cpus.nr_cpus() != 0) {
+            auto conflict = cpus & held;
+            if (conflict.nr_cpus() != 0)
+                throw std::runtime_error{"cpu(s) " + string_util::join(conflict.cpulist(num_cpus), ",") + " are reserved by other jobs"};
+        } else {
+            auto cluster = control_string(d.cluster, sizeof(d.cluster));
+
+            CPUList of_class;
+            if (cluster.empty()) {
+                for (int cpu = 0; cpu < num_cpus; ++cpu)
+                    of_class.set(cpu);
+            } else {
+                auto it = std::find_if(clusters.begin(), clusters.end(), [&](const Cluster& cl) { return cl.name == cluster; });
+                if (it == clusters.end())
+                    throw std::runtime_error{"unknown cpu class '" + cluster + "'"};
+
+                of_class = it->cpus;
+            }
+
+            /* Prefer cpus which nobody else reserved, and then those no client runs on. */
+            CPUList reserved;
+            for (const auto& [other, r] : _reservations) {
+                if (other != job)
+                    reserved |= r.cpus;
+            }
+
+            auto used = used_cpus();
+            std::vector<int> candidates;
+            for (auto cpu : of_class.cpulist(num_cpus)) {
+                if (!held.overlaps_with(CPUList{cpu}) && !_blocked_manually.overlaps_with(CPUList{cpu}))
+                    candidates.push_back(cpu);
+            }
+
+            std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+                    return std::make_pair(reserved.overlaps_with(CPUList{a}), used.overlaps_with(CPUList{a})) <
+                        std::make_pair(reserved.overlaps_with(CPUList{b}), used.overlaps_with(CPUList{b}));
+                });
+
+            if (d.count <= 0 || static_cast<size_t>(d.count) > candidates.size())
+                throw std::runtime_error{"only " + std::to_string(candidates.size()) + " cpu(s) of class '" +
+                    (cluster.empty() ? "any" : cluster) + "' can be reserved"};
+
+            for (int i = 0; i < d.count; ++i)
+                cpus.set(candidates[i]);
+        }
+
+        for (auto it = _reservations.begin(); it != _reservations.end(); ) {
+            if (it->first != job && it->second.cpus.overlaps_with(cpus)) {
+                logger->warning("Reservation of job '%s' displaced by job '%s'\n", it->first.c_str(), job.c_str());
+                ++_stats.reservations_displaced;
+                it = _reservations.erase(it);
+            } else
+                ++it;
+        }
+
+        auto start = platform->now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(d.start_s));
+        auto end = d.ttl_s > 0 ? start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(d.ttl_s))
+            : Clock::time_point::max();
+
+        _reservations[job] = Reservation{job, cpus, d.priority, start, end, false};
+        ++_stats.reservations;
+
+        logger->info("Reserve cpu(s) %s for job '%s' (priority %d)\n", string_util::join(cpus.cpulist(num_cpus), ",").c_str(),
+                job.c_str(), d.priority);
+        if (d.ttl_s > 0)
+            logger->info(" * from %.1f s on for %.1f s\n", d.start_s, d.ttl_s);
+        else
+            logger->info(" * from %.1f s on until released\n", d.start_s);
+
+        update_blocked();
+
+        std::stringstream ss;
+        ss << "Reserved cpu(s) " << string_util::join(cpus.cpulist(num_cpus), ",") << " for job '" << job << "'" << std::endl;
+
+        auto busy = cpus & used_cpus();
+        if (busy.nr_cpus() != 0)
+            ss << "cpu(s) " << string_util::join(busy.cpulist(num_cpus), ",") << " are still in use, the clients are moved at the start" << std::endl;
+
+        return ss.str();
+    }
+
+    std::string unreserve(const std::string& job)
+    {
+        if (_reservations.erase(job) == 0)
+            return "No reservation for job '" + job + "'\n";
+
+        logger->info("Release the reservation of job '%s'\n", job.c_str());
+        ++_stats.reservations_released;
+
+        update_blocked();
+
+        return "Released the reservation of job '" + job + "'\n";
+    }
+
+    void expire_reservations()
+    {
+        auto now = platform->now();
+
+        bool expired = false;
+        for (auto it = _reservations.begin(); it != _reservations.end(); ) {
+            auto& r = it->second;
+            if (!r.started && r.start <= now) {
+                r.started = true;
+
+                auto busy = r.cpus & used_cpus();
+                logger->info("Reservation of job '%s' started on cpu(s) %s\n", r.job.c_str(),
+                        string_util::join(r.cpus.cpulist(num_cpus), ",").c_str());
+                if (busy.nr_cpus() != 0)
+                    evacuate(busy);
+            }
+
+            if (r.end <= now) {
+                logger->info("Reservation of job '%s' expired\n", r.job.c_str());
+                ++_stats.reservations_expired;
+                it = _reservations.erase(it);
+                expired = true;
+            } else
+                ++it;
+        }
+
+        if (expired)
+            update_blocked();
+    }
+
+    /***
+     * Joint placement of clients arriving together
+     ***/
+
+    bool batch_pending() const
+    {
+        return std::any_of(_clients.begin(), _clients.end(),
+                [](const auto& e) { return e.second.state == Client::State::PENDING && e.second.group.empty(); });
+    }
+
+    /* Branch and bound over the candidate mappings of clients which are placed together. */
+    struct BatchSearch
+    {
+        std::vector<std::vector<const Mapping*>> candidates;
+        std::vector<std::vector<double>> values;
+        std::vector<std::vector<double>> energies;
+        std::vector<double>     rest;       /* Upper bound of the value of the clients from i on */
+
+        bool                    complete = false;       /* All clients have to be placed */
+        double                  cluster_penalty = 0;    /* Cost of each further cluster in use */
+        double                  budget = std::numeric_limits<double>::infinity();   /* Energy left */
+
+        std::vector<int>        current;
+        std::vector<int>        best;
+        double                  best_value = -1;
+
+        unsigned long           nodes = 0;
+        unsigned long           max_nodes = 200000;
+
+        void run(size_t i, const CPUList& taken, double value, double energy)
+        {
+            /* More clusters only ever cost more, so the penalty so far already counts. */
+            double penalty = cluster_penalty * std::max(0, clusters_in_use(taken) - 1);
+            if (value - penalty + rest[i] <= best_value + 1e-9 || nodes >= max_nodes)
+                return;
+            ++nodes;
+
+            if (i == candidates.size()) {
+                best_value = value - penalty;
+                best = current;
+                return;
+            }
+
+            for (size_t j = 0; j < candidates[i].size(); ++j) {
+                if (taken.overlaps_with(candidates[i][j]->cpus) || energy + energies[i][j] > budget + 1e-9)
+                    continue;
+
+                current[i] = static_cast<int>(j);
+                run(i + 1, taken | candidates[i][j]->cpus, value + values[i][j], energy + energies[i][j]);
+            }
+
+            current[i] = -1;
+            if (!complete)
+                run(i + 1, taken, value, energy);
+        }
+    };
+
+    constexpr static size_t BATCH_CANDIDATES = 12;
+
+    /* The number of cpus a placement takes on each cluster. */
+    static std::vector<int> footprint(const CPUList& cpus)
+    {
+        std::vector<int> result;
+        for (const auto& cl : clusters)
+            result.push_back((cl.cpus & cpus).nr_cpus());
+
+        return result;
+    }
+
+    /* The placements to consider jointly out of the given ones, which are ordered best first.
+     * How they pack depends on their footprints and on which cpus they take, so the best ones
+     * of each footprint on disjoint cpus are kept, and under a budget the cheapest one of each
+     * footprint as well. The next best ones fill up to BATCH_CANDIDATES. */
+    std::vector<Mapping> diverse_candidates(const std::vector<Mapping>& placements, bool budget) const
+    {
+        std::vector<bool> keep(placements.size(), false);
+        std::map<std::vector<int>, CPUList> covered;
+        std::map<std::vector<int>, size_t> cheapest;
+
+        for (size_t k = 0; k < placements.size(); ++k) {
+            auto fp = footprint(placements[k].cpus);
+
+            auto& cpus = covered[fp];
+            if (!cpus.overlaps_with(placements[k].cpus)) {
+                keep[k] = true;
+                cpus |= placements[k].cpus;
+            }
+
+            auto it = cheapest.find(fp);
+            if (budget && (it == cheapest.end() || energy_of(placements[k]) < energy_of(placements[it->second])))
+                cheapest[fp] = k;
+        }
+
+        for (const auto& [fp, k] : cheapest)
+            keep[k] = true;
+
+        size_t kept = std::count(keep.begin(), keep.end(), true);
+        for (size_t k = 0; k < placements.size() && kept < BATCH_CANDIDATES; ++k) {
+            if (!keep[k]) {
+                keep[k] = true;
+                ++kept;
+            }
+        }
+
+        std::vector<Mapping> result;
+        for (size_t k = 0; k < placements.size(); ++k) {
+            if (keep[k])
+                result.push_back(placements[k]);
+        }
+
+        return result;
+    }
+
+    /* The placements of each client on the cpus left by the running clients. Each placement
+     * is worth the given weight plus its quality. The placements together have to stay within
+     * the energy left by the running clients. */
+    void joint_candidates(const std::vector<Client*>& clients, double weight, std::vector<std::vector<Mapping>>& mappings,
+            BatchSearch& search)
+    {
+        size_t n = clients.size();
+
+        if (_config.energy_budget > 0)
+            search.budget = _config.energy_budget - energy_total();
+
+        mappings.assign(n, {});
+        search.candidates.assign(n, {});
+        search.values.assign(n, {});
+        search.energies.assign(n, {});
+        for (size_t i = 0; i < n; ++i) {
+            Client& c = *clients[i];
+
+            auto fitting = tetris_mappings(filtered_mappings(c), occupied(c));
+            auto resources = ledger(&c);
+            fitting.erase(std::remove_if(fitting.begin(), fitting.end(), [&](const Mapping& m) {
+                        return energy_of(m) > search.budget + 1e-9 || !resources.fits_resources(m) || !within_quota(c, m);
+            }), fitting.end());
+
+            /* Keep the headroom for likely arrivals free, as long as there are other options. */
+            auto headroom = headroom_for(c);
+            if (headroom.nr_cpus() != 0 && std::any_of(fitting.begin(), fitting.end(),
+                        [&](const Mapping& m) { return !headroom.overlaps_with(m.cpus); })) {
+                fitting.erase(std::remove_if(fitting.begin(), fitting.end(),
+                            [&](const Mapping& m) { return headroom.overlaps_with(m.cpus); }), fitting.end());
+            }
+            std::stable_sort(fitting.begin(), fitting.end(), [&c](const Mapping& a, const Mapping& b) {
+                    return quality(c, a) > quality(c, b);
+            });
+
+            mappings[i] = diverse_candidates(distinct_cpusets(c, fitting), std::isfinite(search.budget));
+
+            for (const auto& m : mappings[i]) {
+                search.candidates[i].push_back(&m);
+                search.values[i].push_back(weight + quality(c, m));
+                search.energies[i].push_back(energy_of(m));
+            }
+        }
+    }
+
+    /* The candidate of each client in the best joint placement, -1 for clients which are not
+     * placed. The search starts from the given placement and its value. */
+    std::vector<int> solve_jointly(const BatchSearch& search, const std::vector<int>& initial, double initial_value,
+            unsigned long& nodes)
+    {
+        size_t n = search.candidates.size();
+
+        /* Clients with few options decide first, that prunes the search early. */
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return search.candidates[a].size() < search.candidates[b].size();
+        });
+
+        BatchSearch ordered;
+        ordered.complete = search.complete;
+        ordered.cluster_penalty = search.cluster_penalty;
+        ordered.budget = search.budget;
+        ordered.rest.assign(n + 1, 0);
+        for (size_t k = 0; k < n; ++k) {
+            ordered.candidates.push_back(search.candidates[order[k]]);
+            ordered.values.push_back(search.values[order[k]]);
+            ordered.energies.push_back(search.energies[order[k]]);
+        }
+        for (size_t k = n; k-- > 0;) {
+            double top = ordered.values[k].empty() ? 0 : *std::max_element(ordered.values[k].begin(), ordered.values[k].end());
+            ordered.rest[k] = ordered.rest[k + 1] + top;
+        }
+
+        ordered.current.assign(n, -1);
+        ordered.best.assign(n, -1);
+        for (size_t k = 0; k < n; ++k)
+            ordered.best[k] = initial[order[k]];
+        ordered.best_value = initial_value;
+        ordered.run(0, CPUList{}, 0, 0);
+
+        std::vector<int> result(n, -1);
+        for (size_t k = 0; k < n; ++k)
+            result[order[k]] = ordered.best[k];
+
+        nodes = ordered.nodes;
+        return result;
+    }
+
+    /* The number of clients and the sum of their qualities that placing them one by one in
+     * the order of their arrival achieves. Each client takes its mapping tentatively, so that
+     * the next ones see it; the statistics are left as they were. */
+    void place_sequentially(const std::vector<Client*>& clients, unsigned long& placed, double& objective)
+    {
+        auto stats = _stats;
+        std::vector<std::tuple<Client*, Client::State, Mapping>> saved;
+
+        for (auto c : clients) {
+            try {
+                Mapping m = select_best_mapping(*c);
+
+                ++placed;
+                objective += quality(*c, m);
+
+                saved.emplace_back(c, c->state, c->active_mapping);
+                c->state = Client::State::RUNNING;
+                c->active_mapping = m;
+            } catch (NoMappingError&) {
+                /* It would have to go its own way. */
+            }
+        }
+
+        for (auto& [c, state, mapping] : saved) {
+            c->state = state;
+            c->active_mapping = mapping;
+        }
+
+        _stats = stats;
+    }
+
+    /* Place all pending clients at once. The placement maximizes the number of placed clients
+     * first and the sum of their qualities second. */
+    void place_batch()
+    {
+        std::vector<Client*> batch;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::PENDING && cl.group.empty())
+                batch.push_back(&cl);
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](auto a, auto b) { return a->waiting_since < b->waiting_since; });
+
+        size_t n = batch.size();
+        logger->info("Place a batch of %i client(s) jointly\n", n);
+
+        auto start = Clock::now();
+
+        /* Placing one more client is worth more than any gain in quality. */
+        std::vector<std::vector<Mapping>> mappings;
+        BatchSearch search;
+        joint_candidates(batch, n, mappings, search);
+
+        /* Taking the best candidate of each client in the order of their arrival is where the search starts. */
+        std::vector<int> greedy(n, -1);
+        double greedy_value = 0, greedy_energy = 0;
+        CPUList taken;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < search.candidates[i].size(); ++j) {
+                if (!taken.overlaps_with(search.candidates[i][j]->cpus) &&
+                        greedy_energy + search.energies[i][j] <= search.budget + 1e-9) {
+                    greedy[i] = static_cast<int>(j);
+                    greedy_value += search.values[i][j];
+                    greedy_energy += search.energies[i][j];
+                    taken |= search.candidates[i][j]->cpus;
+                    break;
+                }
+            }
+        }
+
+        unsigned long nodes = 0;
+        auto choice = solve_jointly(search, greedy, greedy_value, nodes);
+
+        double solve_s = elapsed_since(start);
+
+        /* Compare with the placement one by one by the quality of the placed clients. */
+        unsigned long placed = 0, greedy_placed = 0;
+        double objective = 0, greedy_objective = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (choice[i] >= 0) {
+                ++placed;
+                objective += quality(*batch[i], mappings[i][choice[i]]);
+            }
+        }
+        place_sequentially(batch, greedy_placed, greedy_objective);
+
+        logger->info(" * joint placement: %i client(s), quality %.3f (one by one: %i client(s), quality %.3f), "
+                "%i node(s) in %.3f ms\n", placed, objective, greedy_placed, greedy_objective, nodes, 1e3 * solve_s);
+
+        ++_stats.batches;
+        _stats.batched_clients += n;
+        _stats.batch_solve_s += solve_s;
+        _stats.batch_placed += placed;
+        _stats.batch_greedy_placed += greedy_placed;
+        _stats.batch_objective += objective;
+        _stats.batch_greedy_objective += greedy_objective;
+
+        /* Clients without a joint placement go their usual way afterwards. */
+        std::vector<size_t> sequence;
+        for (size_t i = 0; i < n; ++i) {
+            if (choice[i] >= 0)
+                sequence.push_back(i);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (choice[i] < 0)
+                sequence.push_back(i);
+        }
+
+        for (auto i : sequence) {
+            Client& c = *batch[i];
+
+            bool managed = true;
+            bool deferred = false;
+            try {
+                logger->info("Place client '%s' [%d] of the batch\n", c.exec.c_str(), c.pid);
+                /* Moves of running clients in between may have taken the planned cpus. */
+                const Mapping* planned = choice[i] >= 0 ? &mappings[i][choice[i]] : nullptr;
+                if (planned != nullptr && occupied(c).overlaps_with(planned->cpus))
+                    planned = nullptr;
+
+                deferred = place_new_client(c, "", planned);
+            } catch (NoMappingError&) {
+                logger->warning("Couldn't find a proper mapping for client: '%s' [%i]\n", c.exec.c_str(), c.pid);
+                managed = false;
+            }
+
+            if (deferred)
+                continue;
+
+            double wait = seconds_since(c.waiting_since);
+            _stats.batch_wait_s += wait;
+            _stats.max_batch_wait_s = std::max(_stats.max_batch_wait_s, wait);
+
+            /* Clients which are not managed run on their own. */
+            if (!acknowledge(c, managed) || !managed)
+                release(c.id);
+        }
+
+        enforce_slots();
+    }
+
+    /***
+     * Groups of cooperating clients
+     ***/
+
+    /* Members of a group share the cluster, if possible. Each further cluster costs as much
+     * as a quarter of the quality of each member. */
+    constexpr static double GROUP_CLUSTER_PENALTY = 0.25;
+
+    /* The groups whose members wait to be placed, with their members in the order of arrival. */
+    std::map<std::string, std::vector<Client*>> pending_groups()
+    {
+        std::map<std::string, std::vector<Client*>> result;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::PENDING && !cl.group.empty())
+                result[cl.group].push_back(&cl);
+        }
+
+        for (auto& [group, members] : result)
+            std::stable_sort(members.begin(), members.end(), [](auto a, auto b) { return a->waiting_since < b->waiting_since; });
+
+        return result;
+    }
+
+    int group_waiting(const std::string& group) const
+    {
+        return std::count_if(_clients.begin(), _clients.end(), [&group](const auto& e) {
+                return e.second.state == Client::State::PENDING && e.second.group == group;
+        });
+    }
+
+    /* Whether all members of the group are there, as far as they announced the group's size. */
+    bool group_complete(const std::string& group) const
+    {
+        int size = 0;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::PENDING && cl.group == group)
+                size = std::max(size, cl.group_size);
+        }
+
+        return size > 0 && group_waiting(group) >= size;
+    }
+
+    /* Place all members of a group or none of them. */
+    void place_group(const std::string& group, const std::vector<Client*>& members)
+    {
+        size_t n = members.size();
+        bool complete = group_complete(group);
+
+        if (complete)
+            logger->info("Place group '%s' with %i member(s) jointly\n", group.c_str(), n);
+        else
+            logger->warning("Group '%s' is still incomplete, place its %i member(s) jointly\n", group.c_str(), n);
+
+        std::vector<std::vector<Mapping>> mappings;
+        BatchSearch search;
+        joint_candidates(members, 0, mappings, search);
+        search.complete = true;
+        search.cluster_penalty = GROUP_CLUSTER_PENALTY * n;
+
+        unsigned long nodes = 0;
+        auto choice = solve_jointly(search, std::vector<int>(n, -1), -std::numeric_limits<double>::infinity(), nodes);
+        bool placed = std::all_of(choice.begin(), choice.end(), [](int j) { return j >= 0; });
+
+        /* The candidates fit the memory and the quotas each on its own, the members together
+         * have to as well. */
+        if (placed) {
+            std::vector<std::pair<Client*, Mapping>> plan;
+            for (size_t i = 0; i < n; ++i)
+                plan.emplace_back(members[i], mappings[i][choice[i]]);
+
+            auto resources = ledger();
+            for (const auto& [c, m] : plan) {
+                if (!within_quota(*c, m, plan) || !resources.fits_resources(m)) {
+                    logger->warning(" * the members of group '%s' together exceed a quota or the memory\n", group.c_str());
+                    placed = false;
+                    break;
+                }
+
+                resources.add_resources(m);
+            }
+        }
+
+        ++_stats.groups;
+        if (!complete)
+            ++_stats.groups_incomplete;
+
+        if (!placed)
+            logger->warning("No joint placement for group '%s', its member(s) run unmanaged\n", group.c_str());
+
+        /* All members learn their fate before any of them is dropped. A member which can't be
+         * told that it is managed takes the whole group with it. */
+        for (auto c : members) {
+            if (!acknowledge(*c, placed) && placed) {
+                logger->warning("Lost member '%s' [%d] of group '%s', its member(s) run unmanaged\n", c->exec.c_str(),
+                        c->pid, group.c_str());
+                placed = false;
+            }
+        }
+
+        if (!placed) {
+            for (auto c : members)
+                release(c->id);
+            return;
+        }
+
+        CPUList used;
+        for (size_t i = 0; i < n; ++i)
+            used |= mappings[i][choice[i]].cpus;
+
+        logger->info(" * group '%s' uses cpu(s) %s on %i cluster(s), %i node(s) searched\n", group.c_str(),
+                string_util::join(used.cpulist(num_cpus), ",").c_str(), clusters_in_use(used), nodes);
+
+        ++_stats.groups_placed;
+        if (clusters_in_use(used) == 1)
+            ++_stats.groups_one_cluster;
+
+        /* All mappings are applied before anything else can move, so the group stays whole. */
+        for (size_t i = 0; i < n; ++i) {
+            Client& c = *members[i];
+
+            apply_mapping(c, mappings[i][choice[i]]);
+            c.state = Client::State::RUNNING;
+            set_reference(c);
+
+            logger->info(" * mapping of '%s' [%d]: %s (%.0f@%s) [%s]\n", c.exec.c_str(), c.pid,
+                    c.active_mapping.name.c_str(), c.active_mapping.characteristic(c.comp.criteria()),
+                    c.comp.repr().c_str(), c.active_mapping.equivalence_class().name().c_str());
+
+            c.new_thread("@main", c.pid);
+        }
+
+        refresh_waiting();
+        balance();
+        enforce_slots();
+    }
+
+    /***
+     * Time slots for oversubscription
+     ***/
+
+    int slots() const
+    {
+        int result = 1;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SLICED)
+                result = std::max(result, cl.slot + 1);
+        }
+
+        return result;
+    }
+
+    /* The cpus taken by the clients of a time slot. The running clients make up slot 0. */
+    CPUList slot_cpus(int slot, const Client* except) const
+    {
+        CPUList result = _blocked_cpus;
+        for (const auto& [fd, cl] : _clients) {
+            if (&cl == except)
+                continue;
+
+            bool member = slot == 0 ? cl.state == Client::State::RUNNING :
+                (cl.state == Client::State::SLICED && cl.slot == slot);
+            if (member)
+                result |= cl.cpus();
+        }
+
+        return result;
+    }
+
+    /* Find a mapping for the client in the first time slot with room for it, opening a new
+     * slot if necessary. */
+    bool slice(Client& c, Mapping& m)
+    {
+        int limit = std::min(slots() + 1, _config.max_slots);
+
+        for (int slot = 1; slot < limit; ++slot) {
+            _placing_slot = slot;
+            try {
+                m = select_best_mapping(c);
+                _placing_slot = 0;
+
+                logger->info("Place client '%s' [%d] in time slot %d\n", c.exec.c_str(), c.pid, slot);
+                c.slot = slot;
+
+                return true;
+            } catch (NoMappingError&) {
+                /* Try the next slot. */
+            }
+            _placing_slot = 0;
+        }
+
+        logger->debug("No time slot has room for client '%s' [%d]\n", c.exec.c_str(), c.pid);
+
+        return false;
+    }
+
+    /* Number the time slots without gaps again. */
+    void compact_slots()
+    {
+        std::map<int, int> renumber;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SLICED)
+                renumber[cl.slot] = 0;
+        }
+
+        int next = 1;
+        for (auto& [from, to] : renumber)
+            to = next++;
+
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SLICED)
+                cl.slot = renumber[cl.slot];
+        }
+
+        if (_active_slot != 0) {
+            if (renumber.find(_active_slot) != renumber.end()) {
+                _active_slot = renumber[_active_slot];
+            } else {
+                _active_slot = 0;
+                _slot_start = platform->now();
+            }
+        }
+    }
+
+    /* Clients in time slots get a mapping of their own as soon as one fits. */
+    void unslice_clients()
+    {
+        std::vector<Client*> sliced;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SLICED)
+                sliced.push_back(&cl);
+        }
+
+        std::stable_sort(sliced.begin(), sliced.end(), [](auto a, auto b) { return a->slot < b->slot; });
+
+        for (auto cl : sliced) {
+            try {
+                auto m = select_best_mapping(*cl);
+
+                logger->info("Client '%s' [%d] leaves time slot %d\n", cl->exec.c_str(), cl->pid, cl->slot);
+
+                cl->state = Client::State::RUNNING;
+                cl->slot = 0;
+                apply_mapping(*cl, m);
+                set_reference(*cl);
+
+                ++_stats.unsliced;
+            } catch (NoMappingError&) {
+                /* Still no room. */
+            }
+        }
+
+        compact_slots();
+        enforce_slots();
+    }
+
+    /* Stop the clients outside of the active time slot and continue the ones in it. */
+    void enforce_slots()
+    {
+        bool rotating = slots() > 1;
+        if (!rotating)
+            _active_slot = 0;
+
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state != Client::State::RUNNING && cl.state != Client::State::SLICED)
+                continue;
+
+            bool run = !rotating || cl.slot == _active_slot;
+            if (run == !cl.stopped)
+                continue;
+
+            if (!platform->send_signal(cl.pid, run ? SIGCONT : SIGSTOP))
+                logger->warning("Failed to %s client '%s' [%d]: %s\n", run ? "continue" : "stop", cl.exec.c_str(),
+                        cl.pid, strerror(errno));
+
+            cl.stopped = !run;
+            ++_stats.slice_signals;
+        }
+    }
+
+    void rotate_slots()
+    {
+        int n = slots();
+        if (n == 1 || seconds_since(_slot_start) < _config.quantum_s)
+            return;
+
+        /* The other slots are never empty, but slot 0 is if no client runs on a mapping of its own. */
+        int next = (_active_slot + 1) % n;
+        if (next == 0 && std::none_of(_clients.begin(), _clients.end(),
+                    [](const auto& e) { return e.second.state == Client::State::RUNNING; }))
+            next = 1;
+
+        _slot_start = platform->now();
+        if (next == _active_slot)
+            return;
+
+        logger->debug("Switch from time slot %d to %d\n", _active_slot, next);
+
+        _active_slot = next;
+        ++_stats.rotations;
+
+        enforce_slots();
+    }
+
+    void expire_suspended()
+    {
+        /* Suspended clients which waited too long run unmanaged after all. */
+        std::vector<int> expired;
+        for (auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SUSPENDED && seconds_since(cl.waiting_since) >= _config.max_suspend_s)
+                expired.push_back(fd);
+        }
+
+        for (auto fd : expired) {
+            Client& c = _clients.at(fd);
+
+            logger->warning("Client '%s' [%d] waited too long for a mapping, run it unmanaged\n", c.exec.c_str(), c.pid);
+
+            acknowledge(c, false);
+            resume(c);
+
+            ++_stats.suspend_timeouts;
+            release(fd);
+        }
+    }
+
+    void report_free_cpus()
+    {
+        auto free = free_cpus();
+
+        std::vector<std::string> free_clusters;
+        for (const auto& cl : clusters) {
+            if ((cl.cpus & free) == cl.cpus)
+                free_clusters.push_back(cl.name);
+        }
+
+        logger->info("Free cpu(s): %s (free cluster(s): %s)\n",
+                free.nr_cpus() == 0 ? "none" : string_util::join(free.cpulist(num_cpus), ",").c_str(),
+                free_clusters.empty() ? "none" : string_util::join(free_clusters, ",").c_str());
+
+        if (_config.park_cpus) {
+            auto parked = _parking.park(free);
+            if (parked.nr_cpus() != 0)
+                logger->info(" * parked cpu(s) %s\n", string_util::join(parked.cpulist(num_cpus), ",").c_str());
+        }
+    }
+
+   public:
+    Manager(const std::string& mappings_path, const ServerConfig& config,
+            const PlacementPolicyPtr& policy = std::make_shared<GreedyPolicy>(), const Quotas& quotas = Quotas{}) :
+        _clients{}, _mappings_path{mappings_path}, _mappings{}, _blocked_cpus{}, _blocked_manually{},
+        _reservations{}, _config{config},
+        _parking{config.park_cpus ? config.sysfs_root : ""}, _policy{policy}, _quotas{quotas}, _stats{}, _predictions{}, _generation{0},
+        _probing{false}, _journal{},
+        _explorer{config.explore_seed < 0 ? std::random_device{}() : static_cast<unsigned>(config.explore_seed)},
+        _interference{}, _deadline{Clock::time_point::max()}, _truncated{false}, _gap{0},
+        _active_slot{0}, _slot_start{platform->now()}, _placing_slot{0},
+        _batch_start{}
+    {
+        update_mappings();
+
+        if (!config.journal_path.empty()) {
+            try {
+                _journal.open(config.journal_path, platform->now());
+                logger->info("Journaling input events to %s\n", config.journal_path.c_str());
+            } catch (std::runtime_error& e) {
+                logger->error("%s\n", e.what());
+            }
+        }
+
+        if (!config.interference_path.empty()) {
+            try {
+                _interference.load(config.interference_path);
+                logger->info("Slowdowns of co-located programs loaded from %s\n", config.interference_path.c_str());
+            } catch (std::runtime_error& e) {
+                logger->error("%s\n", e.what());
+            }
+        }
+
+        if (config.explore && !config.explore_state_path.empty()) {
+            try {
+                _explorer.load(config.explore_state_path);
+                logger->info("Exploration state of %d program(s) loaded from %s\n", _explorer.programs().size(),
+                        config.explore_state_path.c_str());
+            } catch (std::runtime_error& e) {
+                logger->error("%s\n", e.what());
+            }
+        }
+    }
+
+    ~Manager()
+    {
+        /* Leave the system with all CPUs online again. */
+        _parking.unpark(_parking.parked());
+
+        /* Don't leave clients behind stopped. */
+        for (auto cl : queued_clients()) {
+            if (cl->state == Client::State::SUSPENDED) {
+                acknowledge(*cl, false);
+                resume(*cl);
+            }
+        }
+
+        for (auto& [fd, cl] : _clients) {
+            if (cl.stopped)
+                resume(cl);
+        }
+    }
+
+    /* Time until the next timed event of the manager in ms, or -1 if there is none. */
+    int timeout() const
+    {
+        double next = -1;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state != Client::State::SUSPENDED)
+                continue;
+
+            double remaining = std::max(0.0, _config.max_suspend_s - seconds_since(cl.waiting_since));
+            if (next < 0 || remaining < next)
+                next = remaining;
+        }
+
+        /* Arrival probabilities change over time. */
+        if (_config.predict && (next < 0 || next > 1))
+            next = 1;
+
+        /* Clients arriving together are placed at the end of the batch window. */
+        if (batch_pending()) {
+            double remaining = std::max(0.0, _config.batch_window_s - seconds_since(_batch_start));
+            if (next < 0 || remaining < next)
+                next = remaining;
+        }
+
+        /* Groups are placed once they are complete or waited long enough. */
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state != Client::State::PENDING || cl.group.empty())
+                continue;
+
+            double remaining = 0;
+            if (!group_complete(cl.group))
+                remaining = std::max(0.0, _config.group_timeout_s - seconds_since(cl.waiting_since));
+
+            if (next < 0 || remaining < next)
+                next = remaining;
+        }
+
+        /* The time slots take turns after each quantum. */
+        if (slots() > 1) {
+            double remaining = std::max(0.0, _config.quantum_s - seconds_since(_slot_start));
+            if (next < 0 || remaining < next)
+                next = remaining;
+        }
+
+        /* Reservations start and expire. */
+        auto now = platform->now();
+        for (const auto& [job, r] : _reservations) {
+            auto at = r.started ? r.end : r.start;
+            if (at == Clock::time_point::max())
+                continue;
+
+            double remaining = std::max(0.0, std::chrono::duration<double>(at - now).count());
+            if (next < 0 || remaining < next)
+                next = remaining;
+        }
+
+        /* Searches stopped at their deadline are completed right away. */
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.refine)
+                next = 0;
+        }
+
+        /* Events far ahead are waited for in steps, the timeout is an int of milliseconds. */
+        if (next < 0)
+            return -1;
+
+        return static_cast<int>(std::min(std::ceil(next * 1000), static_cast<double>(std::numeric_limits<int>::max())));
+    }
+
+    void tick()
+    {
+        if (batch_pending() && seconds_since(_batch_start) >= _config.batch_window_s)
+            place_batch();
+
+        for (const auto& [group, members] : pending_groups()) {
+            if (group_complete(group) || seconds_since(members.front()->waiting_since) >= _config.group_timeout_s)
+                place_group(group, members);
+        }
+
+        expire_suspended();
+        expire_reservations();
+        rotate_slots();
+        refine_mappings();
+        refresh_predictions();
+    }
+
+    void client_connect(int fd, const ConnectionPtr& conn)
+    {
+        _journal.record(Journal::Event::CONNECT, fd, platform->now());
+        _clients.emplace(std::piecewise_construct, std::forward_as_tuple(fd), std::forward_as_tuple(fd, conn));
+    }
+
+    void client_disconnect(int fd)
+    {
+        _journal.record(Journal::Event::DISCONNECT, fd, platform->now());
+
+        auto it = _clients.find(fd);
+        if (it != _clients.end())
+            finish_run(it->second);
+
+        _clients.erase(fd);
+        ++_generation;
+
+        if (_config.compact)
+            compact();
+
+        unslice_clients();
+        admit_waiting();
+        upgrade_clients();
+        balance();
+        enforce_slots();
+        report_free_cpus();
+    }
+
+    void remap(int fd, const std::string& preferred_mapping_name)
+    try {
+        Client& c = _clients.at(fd);
+
+        logger->info("Change mapping for client '%s' [%d] to mapping %s\n",
+                c.exec.c_str(), c.pid, preferred_mapping_name.c_str());
+
+        auto it = std::find_if(c.mappings.begin(), c.mappings.end(), [&](const auto& m) { return m.name == preferred_mapping_name; });
+        if (it == c.mappings.end()) {
+            logger->info("Unknown mapping %s for client %i\n", preferred_mapping_name.c_str(), fd);
+            return;
+        } else {
+            logger->info("Changing mapping for client '%s' [%d] to mapping %s\n",
+                    c.exec.c_str(), c.pid, preferred_mapping_name.c_str());
+            apply_mapping(c, *it);
+        }
+    } catch (std::out_of_range&) {
+        logger->error("Unknown client %i\n", fd);
+    }
+
+    bool client_message(int fd)
+    try {
+        Client& c = _clients.at(fd);
+        ConnectionPtr conn = c.connection;
+
+        bool done = false;
+        bool close = false;
+
+        while (!done) {
+            TetrisData message;
+
+            auto res = conn->read(message);
+
+            if (res == Connection::InState::DONE) {
+                /* We are done processing. So return. */
+                done = true;
+            } else if (res == Connection::InState::CLOSED) {
+                /* We are done processing and the remote site closed the
+                 * connection. */
+                close = true;
+                done = true;
+            } else {
+                _journal.record(Journal::Event::MESSAGE, fd, platform->now(), &message);
+
+                /* There is some data to process. Handle it. */
+                switch (message.op) {
+                    case TetrisData::NEW_CLIENT: {
+                        int pid = message.new_client_data.pid;
+                        std::string exec = string_util::strip(path_util::basename(message.new_client_data.exec));
+                        bool managed;
+                        bool deferred = false;
+                        try {
+                            logger->always("New client registered: '%s' [%d] (ID: %d)\n", exec.c_str(), pid, fd);
+
+                            /* Update the client data. */
+                            c.pid = pid;
+                            c.exec = exec;
+                            identify(c);
+                            pid = c.pid;
+                            c.dynamic_client = message.new_client_data.dynamic_client;
+                            c.admission = message.new_client_data.admission;
+                            c.priority = message.new_client_data.priority;
+                            c.exclusive = message.new_client_data.exclusive;
+                            c.max_degradation = message.new_client_data.has_max_degradation ?
+                                message.new_client_data.max_degradation : _config.max_degradation;
+                            c.mappings = _mappings.at(exec);
+
+                            c.comp = Client::Comp(string_util::strip(message.new_client_data.compare_criteria),
+                                    message.new_client_data.compare_more_is_better);
+
+                            logger->info(" * criteria: %s\n", c.comp.repr().c_str());
+                            rank_mappings(c);
+
+                            if (message.new_client_data.has_filter_criteria)
+                                c.filter = parse_filter(message.new_client_data.filter_criteria,
+                                        sizeof(message.new_client_data.filter_criteria));
+
+                            logger->info(" * filter: %s\n", c.filter.repr().c_str());
+                            logger->info(" * priority: %d (max. degradation %.1f%%)\n", c.priority, 100 * c.max_degradation);
+                            if (c.exclusive)
+                                logger->info(" * exclusive cpus\n");
+                            set_best_value(c);
+
+                            record_arrival(c);
+
+                            std::string preferred_mapping;
+                            if (message.new_client_data.has_preferred_mapping)
+                                preferred_mapping = string_util::strip(message.new_client_data.preferred_mapping);
+
+                            c.group = string_util::strip(std::string{message.new_client_data.group,
+                                    strnlen(message.new_client_data.group, sizeof(message.new_client_data.group))});
+                            c.group_size = message.new_client_data.group_size;
+
+                            if (!c.group.empty()) {
+                                /* Groups are placed once all of their members are there. */
+                                c.state = Client::State::PENDING;
+                                c.waiting_since = platform->now();
+                                deferred = true;
+
+                                logger->info(" * group: %s (%d of %d member(s))\n", c.group.c_str(),
+                                        group_waiting(c.group), c.group_size);
+                            } else if (_config.batch_window_s > 0 && preferred_mapping.empty()) {
+                                /* Clients arriving together are placed together. */
+                                if (!batch_pending())
+                                    _batch_start = platform->now();
+
+                                c.state = Client::State::PENDING;
+                                c.waiting_since = platform->now();
+                                deferred = true;
+
+                                logger->info(" * mapping: (pending until the arrival batch is placed)\n");
+                            } else {
+                                deferred = place_new_client(c, preferred_mapping);
+                            }
+
+                            /* We will manage this client. */
+                            managed = true;
+                        } catch (std::out_of_range&) {
+                            logger->error("Unknown client: '%s' [%i]\n", exec.c_str(), pid);
+                            managed = false;
+                        } catch (NoMappingError&) {
+                            logger->warning("Couldn't find a proper mapping for client: '%s' [%i]\n", exec.c_str(), pid);
+                            managed = false;
+                        }
+
+                        /* Clients placed while another time slot runs have to wait for their turn. */
+                        enforce_slots();
+
+                        /* Suspended clients are acknowledged once they are admitted. */
+                        if (deferred)
+                            break;
+
+                        /* We need to acknowledge this message. */
+                        if (!acknowledge(c, managed))
+                            managed = false;
+
+                        /* If we don't manage this client we can close its connection. */
+                        close = !managed;
+                        break;
+                    }
+                    case TetrisData::Operations::NEW_THREAD: {
+                        int tid = message.new_thread_data.tid;
+                        std::string name = string_util::strip(message.new_thread_data.name);
+                        bool managed;
+                        try {
+                            /* Update the client data. */
+                            c.new_thread(name, tid);
+                            managed = true;
+                        } catch (std::out_of_range) {
+                            logger->error("Unknown thread: '%s' [%i] for client '%s'\n", name.c_str(), tid, c.exec.c_str());
+                            managed = false;
+                        }
+
+                        /* We need to acknowledge this message. */
+                        TetrisData ack;
+                        ack.op = TetrisData::NEW_THREAD_ACK;
+                        ack.new_thread_ack_data.managed = managed;
+
+                        if (conn->write(ack) != Connection::OutState::DONE)
+                            logger->error("Failed to acknowledge the new-thread message\n");
+
+                        break;
+                    }
+                    default:
+                        logger->warning("Other message received\n");
+                }
+            }
+        }
+
+        return close;
+    } catch (std::out_of_range) {
+        logger->warning("Received message for unknown client %i\n", fd);
+        return true;
+    } catch (std::runtime_error& e) {
+        logger->warning("Error working with message for client %i: %s", fd, e.what());
+        return true;
+    }
+
+    static void send_reply(Connection& conn, const std::string& text)
+    {
+        /* Replies are sent in chunks, the last one is marked as such. */
+        size_t pos = 0;
+        do {
+            ControlReply reply;
+            std::memset(&reply, 0, sizeof(reply));
+
+            auto len = std::min(text.size() - pos, sizeof(reply.text) - 1);
+            text.copy(reply.text, len, pos);
+            pos += len;
+            reply.last = pos >= text.size();
+
+            if (conn.write(reply) != Connection::OutState::DONE) {
+                logger->warning("Failed to send control reply\n");
+                return;
+            }
+        } while (pos < text.size());
+    }
+
+    void control_message(ControlData& data, Connection& conn)
+    try {
+        _journal.record(Journal::Event::CONTROL, -1, platform->now(), &data);
+
+        switch (data.op) {
+            case ControlData::Operations::UPDATE_CLIENT: {
+                Client& c = _clients.at(data.update_data.client_fd);
+
+                logger->info("Update client: '%s' [%d]\n", c.exec.c_str(), c.pid);
+
+                /* Update the client's options according to the given new
+                 * values and select a new mapping based on the new criteria. */
+                if (data.update_data.has_dynamic_client) {
+                    c.dynamic_client = data.update_data.dynamic_client;
+
+                    logger->info(" * change thread placement: %s\n", c.dynamic_client ? "CFS" : "static");
+                }
+
+                if (data.update_data.has_compare_criteria) {
+                    c.comp = Client::Comp(string_util::strip(data.update_data.compare_criteria),
+                            data.update_data.compare_more_is_better);
+
+                    logger->info(" * change criteria: %s\n", c.comp.repr().c_str());
+                    rank_mappings(c);
+                }
+
+                if (data.update_data.has_filter_criteria) {
+                    c.filter = parse_filter(data.update_data.filter_criteria, sizeof(data.update_data.filter_criteria));
+
+                    logger->info(" * change filter: %s\n", c.filter.repr().c_str());
+                }
+
+                if (data.update_data.has_compare_criteria || data.update_data.has_filter_criteria)
+                    set_best_value(c);
+
+                if (data.update_data.has_priority) {
+                    c.priority = data.update_data.priority;
+
+                    logger->info(" * change priority: %d\n", c.priority);
+                }
+
+                if (data.update_data.has_max_degradation) {
+                    c.max_degradation = data.update_data.max_degradation;
+
+                    logger->info(" * change max. degradation: %.1f%%\n", 100 * c.max_degradation);
+                }
+
+                if (c.state == Client::State::WAITING) {
+                    /* Queued clients get their mapping as soon as one fits. */
+                    admit_waiting();
+                    break;
+                }
+
+                if (c.state == Client::State::SLICED) {
+                    /* Clients in a time slot leave it as soon as a mapping fits. */
+                    unslice_clients();
+                    break;
+                }
+
+                if (data.update_data.has_preferred_mapping) {
+                    std::string preferred_mapping = string_util::strip(data.update_data.preferred_mapping);
+                    apply_mapping(c, use_preferred_mapping(c, preferred_mapping));
+                } else {
+                    apply_mapping(c, select_with_preemption(c));
+                }
+                set_reference(c);
+                refresh_waiting();
+                balance();
+
+                logger->info(" * mapping: %s (%.0f@%s) [%s]\n", c.active_mapping.name.c_str(),
+                        c.active_mapping.characteristic(c.comp.criteria()), c.comp.repr().c_str(),
+                        c.active_mapping.equivalence_class().name().c_str());
+
+                break;
+            }
+            case ControlData::Operations::BLOCK_CPUS: {
+                logger->info("Update blocked cpus\n");
+
+                _blocked_manually = data.block_cpus_data.cpus;
+
+                if (_blocked_manually.nr_cpus() == 0)
+                    logger->info(" * blocked: none\n");
+                else
+                    logger->info(" * blocked: %s\n", string_util::join(_blocked_manually.cpulist(num_cpus), ",").c_str());
+
+                update_blocked();
+
+                auto evacuation = evacuate(_blocked_manually);
+                report_free_cpus();
+
+                send_reply(conn, evacuation_repr(evacuation));
+                break;
+            }
+            case ControlData::Operations::RESERVE: {
+                std::string reply;
+                try {
+                    reply = reserve(data);
+                } catch (std::runtime_error& e) {
+                    logger->warning("Reservation rejected: %s\n", e.what());
+                    ++_stats.reservations_rejected;
+                    reply = std::string{"Reservation rejected: "} + e.what() + "\n";
+                }
+
+                send_reply(conn, reply);
+                break;
+            }
+            case ControlData::Operations::UNRESERVE: {
+                send_reply(conn, unreserve(control_string(data.reserve_data.job, sizeof(data.reserve_data.job))));
+                break;
+            }
+            case ControlData::Operations::RESERVATIONS: {
+                std::stringstream ss;
+                print_reservations(ss);
+
+                send_reply(conn, ss.str());
+                break;
+            }
+            case ControlData::Operations::ENERGY_BUDGET: {
+                if (data.energy_budget_data.set) {
+                    _config.energy_budget = data.energy_budget_data.budget;
+
+                    logger->info("Update energy budget: %.0f\n", _config.energy_budget);
+
+                    enforce_budget();
+                    admit_waiting();
+                }
+
+                std::stringstream ss;
+                print_budget(ss);
+
+                send_reply(conn, ss.str());
+                break;
+            }
+            case ControlData::Operations::STATS: {
+                std::stringstream ss;
+                print_stats(ss);
+
+                send_reply(conn, ss.str());
+                break;
+            }
+            default:
+                logger->warning("Other control message received\n");
+        }
+    } catch (std::out_of_range) {
+        logger->warning("Received control message for unknown client\n");
+    } catch (NoMappingError&) {
+        logger->warning("Couldn't find a proper mapping, keep the current one\n");
+    }
+
+    const Client* client(int fd) const
+    {
+        auto it = _clients.find(fd);
+        return it == _clients.end() ? nullptr : &it->second;
+    }
+
+    const ServerStats& stats() const
+    {
+        return _stats;
+    }
+
+    void print_interference(std::ostream& os)
+    {
+        if (!interference_enabled()) {
+            os << "Interference (disabled)" << std::endl;
+            return;
+        }
+
+        os << "Interference" << (_config.interference_learn ? " (learning)" : "") << ":" << std::endl
+           << "-> placements next to interfering clients: " << _stats.interfered << " (max. slowdown "
+           << _stats.max_slowdown << ")" << std::endl
+           << "-> observed runs: " << _stats.interference_observations << std::endl;
+        for (const auto& [pair, value] : _interference.configured())
+            os << "--> '" << pair.first << "' next to '" << pair.second << "': " << value << " (configured)" << std::endl;
+        for (const auto& [pair, l] : _interference.learned())
+            os << "--> '" << pair.first << "' next to '" << pair.second << "': " << l.value << " (learned from "
+               << l.runs << " run(s))" << std::endl;
+    }
+
+    void print_resources(std::ostream& os)
+    {
+        auto ledger = this->ledger();
+        if (ledger.dimensions().empty()) {
+            os << "Memory packing (disabled)" << std::endl;
+            return;
+        }
+
+        os << "Memory packing:" << std::endl
+           << "-> restricted searches: " << _stats.resource_restricted << " (nothing fits: " << _stats.resource_rejected
+           << ")" << std::endl;
+        for (const auto& d : ledger.dimensions()) {
+            for (size_t i = 0; i < d.nodes.size(); ++i)
+                os << "--> " << d.criteria << " on cpu(s) " << string_util::join(d.nodes[i].cpulist(num_cpus), ",") << ": "
+                   << d.used[i] << " of " << d.capacity[i] << " in use" << std::endl;
+        }
+    }
+
+    void print_quotas(std::ostream& os)
+    {
+        if (_quotas.empty()) {
+            os << "Quotas (disabled)" << std::endl;
+            return;
+        }
+
+        os << "Quotas:" << std::endl
+           << "-> restricted searches: " << _stats.quota_restricted << " (nothing within the quotas: "
+           << _stats.quota_rejected << ")" << std::endl;
+
+        std::map<std::string, std::pair<int, const Client*>> tenants;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state != Client::State::RUNNING)
+                continue;
+
+            if (_quotas.user(cl.uid, cl.user) != nullptr) {
+                auto& t = tenants["user '" + cl.user + "'"];
+                t.first += cl.cpus().nr_cpus();
+                t.second = &cl;
+            }
+
+            auto cgroup = _quotas.cgroup_of(cl.cgroup);
+            if (!cgroup.empty()) {
+                auto& t = tenants["cgroup '" + cgroup + "'"];
+                t.first += cl.cpus().nr_cpus();
+                t.second = &cl;
+            }
+        }
+
+        for (const auto& [tenant, usage] : tenants) {
+            const Quota* q = tenant.compare(0, 4, "user") == 0 ? _quotas.user(usage.second->uid, usage.second->user)
+                : _quotas.cgroup(_quotas.cgroup_of(usage.second->cgroup));
+            os << "--> " << tenant << ": " << usage.first << " cpu(s) in use, quota " << q->repr() << std::endl;
+        }
+    }
+
+    void print_evacuations(std::ostream& os)
+    {
+        os << "Evacuation:" << std::endl
+           << "-> evacuations: " << _stats.evacuations << " (moved: " << _stats.evacuated_clients << ", stranded: "
+           << _stats.stranded_clients << ")" << std::endl
+           << "-> duration: avg. " << (_stats.evacuations != 0 ? 1e3 * _stats.evacuation_s / _stats.evacuations : 0.0)
+           << " ms, max. " << 1e3 * _stats.max_evacuation_s << " ms" << std::endl;
+    }
+
+    void print_reservations(std::ostream& os)
+    {
+        os << "Reservations:" << std::endl
+           << "-> reserved: " << _stats.reservations << " (rejected: " << _stats.reservations_rejected << ", displaced: "
+           << _stats.reservations_displaced << ", released: " << _stats.reservations_released << ", expired: "
+           << _stats.reservations_expired << ")" << std::endl;
+
+        auto now = platform->now();
+        auto used = used_cpus();
+        for (const auto& [job, r] : _reservations) {
+            os << "--> '" << job << "' (priority " << r.priority << "): cpu(s) " << string_util::join(r.cpus.cpulist(num_cpus), ",");
+            if (r.start > now)
+                os << ", starts in " << std::chrono::duration<double>(r.start - now).count() << " s";
+            else
+                os << ", active";
+
+            if (r.end != Clock::time_point::max())
+                os << ", expires in " << std::chrono::duration<double>(r.end - now).count() << " s";
+
+            auto busy = r.cpus & used;
+            if (busy.nr_cpus() != 0)
+                os << ", still in use: " << string_util::join(busy.cpulist(num_cpus), ",");
+            os << std::endl;
+        }
+    }
+
+    void print_exploration(std::ostream& os)
+    {
+        if (!_config.explore) {
+            os << "Exploration (disabled)" << std::endl;
+            return;
+        }
+
+        os << "Exploration (rate " << _config.explore_rate << ", tolerance " << _config.explore_tolerance << "):" << std::endl
+           << "-> runs: " << _stats.explored_runs << " (other than the policy's choice: " << _stats.explorations
+           << ", observed: " << _stats.observations << ")" << std::endl;
+        for (const auto& [exec, arms] : _explorer.programs()) {
+            os << "--> '" << exec << "':" << std::endl;
+            for (const auto& [name, a] : arms)
+                os << "---> " << name << ": " << a.runs << " run(s), " << a.mean << " s (predicted " << a.predicted
+                   << ", expected " << _explorer.posterior(exec, name, a.predicted).first << " s)" << std::endl;
+        }
+    }
+
+    void print_groups(std::ostream& os)
+    {
+        os << "Groups:" << std::endl
+           << "-> groups: " << _stats.groups << " (placed: " << _stats.groups_placed << ", on one cluster: "
+           << _stats.groups_one_cluster << ", incomplete: " << _stats.groups_incomplete << ")" << std::endl;
+        for (const auto& [group, members] : pending_groups())
+            os << "--> '" << group << "': " << members.size() << " member(s) waiting" << std::endl;
+    }
+
+    void print_batches(std::ostream& os)
+    {
+        if (_config.batch_window_s <= 0) {
+            os << "Batch admission (disabled)" << std::endl;
+            return;
+        }
+
+        os << "Batch admission (window " << _config.batch_window_s << " s):" << std::endl
+           << "-> batches: " << _stats.batches << " (clients: " << _stats.batched_clients << ", avg. solve time "
+           << (_stats.batches != 0 ? 1e3 * _stats.batch_solve_s / _stats.batches : 0.0) << " ms)" << std::endl
+           << "-> joint placement: " << _stats.batch_placed << " client(s), quality " << _stats.batch_objective << std::endl
+           << "-> one by one: " << _stats.batch_greedy_placed << " client(s), quality " << _stats.batch_greedy_objective << std::endl
+           << "-> added admission latency: avg. "
+           << (_stats.batched_clients != 0 ? 1e3 * _stats.batch_wait_s / _stats.batched_clients : 0.0)
+           << " ms, max. " << 1e3 * _stats.max_batch_wait_s << " ms" << std::endl;
+    }
+
+    void print_slots(std::ostream& os)
+    {
+        if (!_config.timeslice) {
+            os << "Time slicing (disabled)" << std::endl;
+            return;
+        }
+
+        os << "Time slicing (quantum " << _config.quantum_s << " s):" << std::endl
+           << "-> slots: " << slots() << " (active: " << _active_slot << ")" << std::endl
+           << "-> sliced clients: " << _stats.sliced << " (got a mapping of their own: " << _stats.unsliced << ")" << std::endl
+           << "-> rotations: " << _stats.rotations << ", signals: " << _stats.slice_signals << std::endl;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::SLICED)
+                os << "--> '" << cl.exec << "' [" << cl.pid << "]: slot " << cl.slot << " on "
+                   << string_util::join(cl.cpus().cpulist(num_cpus), ",") << std::endl;
+        }
+    }
+
+    void print_colocation(std::ostream& os)
+    {
+        if (_config.colocate_limit <= 0) {
+            os << "Co-location (disabled)" << std::endl;
+            return;
+        }
+
+        int running = 0;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::RUNNING)
+                ++running;
+        }
+
+        auto ledger = this->ledger();
+        int used = used_cpus().nr_cpus();
+
+        os << "Co-location (limit " << _config.colocate_limit << "):" << std::endl
+           << "-> co-located placements: " << _stats.colocated << std::endl
+           << "-> clients per used cpu: " << (used != 0 ? static_cast<double>(running) / used : 0.0) << std::endl;
+        for (auto cpu : ledger.partial().cpulist(num_cpus))
+            os << "--> cpu " << cpu << ": " << 100 * ledger.load(cpu) << "% utilised" << std::endl;
+    }
+
+    void print_stats(std::ostream& os)
+    {
+        auto queue = queued_clients();
+
+        os << "Server statistics:" << std::endl
+           << "==================" << std::endl;
+        os << "Admission queue (" << (_config.queue ? queue_order_name(_config.queue_order) : "disabled") << "):" << std::endl
+           << "-> length: " << queue.size() << " (max: " << _stats.max_queue_length << ")" << std::endl
+           << "-> queued: " << _stats.queued << std::endl
+           << "-> admitted: " << _stats.admitted_from_queue << std::endl
+           << "-> wait time: avg " << std::fixed << std::setprecision(3)
+           << (_stats.admitted_from_queue != 0 ? _stats.total_wait_s / _stats.admitted_from_queue : 0.0)
+           << " s, max " << _stats.max_wait_s << " s" << std::endl
+           << "-> suspended: " << _stats.suspended << " (timed out: " << _stats.suspend_timeouts << ")" << std::endl;
+        for (auto cl : queue)
+            os << "--> '" << cl->exec << "' [" << cl->pid << "] " << (cl->state == Client::State::SUSPENDED ? "suspended" : "waiting")
+               << " for " << seconds_since(cl->waiting_since) << " s" << std::endl;
+        os << "Preemption:" << std::endl
+           << "-> remappings: " << _stats.preemptions << " (clients moved: " << _stats.preempted_clients << ")" << std::endl;
+        print_fairness(os);
+        os << "Synthesis (" << (_config.synthesize ? "enabled" : "disabled") << "):" << std::endl
+           << "-> synthesized mappings: " << _stats.synthesized << std::endl;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.active_mapping.synthesized)
+                os << "--> '" << cl.exec << "' [" << cl.pid << "]: " << cl.active_mapping.name << " on "
+                   << string_util::join(cl.cpus().cpulist(num_cpus), ",") << std::endl;
+        }
+        print_colocation(os);
+        print_slots(os);
+        print_batches(os);
+        print_groups(os);
+        print_interference(os);
+        print_resources(os);
+        print_quotas(os);
+        print_evacuations(os);
+        print_reservations(os);
+        print_exploration(os);
+        os << "Upgrades (" << (_config.upgrade ? "enabled" : "disabled") << "):" << std::endl
+           << "-> upgrades: " << _stats.upgrades << " (avg. gain "
+           << (_stats.upgrades != 0 ? 100 * _stats.upgrade_gain / _stats.upgrades : 0.0) << "%)" << std::endl;
+        print_budget(os);
+        os << std::setprecision(3);
+        os << "Decisions:" << std::endl
+           << "-> policy: " << _policy->name() << std::endl
+           << "-> searches: " << _stats.decisions << " (avg. "
+           << (_stats.decisions != 0 ? 1e6 * _stats.decision_time_s / _stats.decisions : 0.0) << " us)" << std::endl;
+        if (_config.deadline_s > 0)
+            os << "-> deadline: " << 1e6 * _config.deadline_s << " us, reached: " << _stats.deadline_hits << " (gap: avg "
+               << (_stats.deadline_hits != 0 ? 100 * _stats.total_gap / _stats.deadline_hits : 0.0) << "%, max "
+               << 100 * _stats.max_gap << "%)" << std::endl
+               << "-> refinements: " << _stats.refinements << " (improved: " << _stats.refined << ")" << std::endl;
+        os << "Prediction (" << (_config.predict ? "enabled" : "disabled") << "):" << std::endl
+           << "-> arrivals: " << _stats.arrivals << " (predicted: " << _stats.predicted_arrivals << ")" << std::endl
+           << "-> hits: " << _stats.prediction_hits << " (hit rate: "
+           << (_stats.arrivals != 0 ? 100.0 * _stats.prediction_hits / _stats.arrivals : 0.0) << "%)" << std::endl
+           << "-> saved search time: " << 1e6 * _stats.prediction_saved_s << " us" << std::endl;
+        for (const auto& [exec, p] : _predictions) {
+            if (!p.likely)
+                continue;
+
+            os << "--> '" << exec << "' likely (" << p.history.probability(platform->now(), _config.predict_horizon_s) << ")";
+            if (p.has_mapping)
+                os << ", headroom: " << string_util::join(p.mapping.cpus.cpulist(num_cpus), ",");
+            os << std::endl;
+        }
+        os << "======= END OF STATS ======" << std::endl;
+    }
+
+    void print_fairness(std::ostream& os)
+    {
+        double min = 1;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::RUNNING)
+                min = std::min(min, quality(cl));
+        }
+
+        os << "Fairness (" << (_config.fair ? "enabled" : "disabled") << "):" << std::endl
+           << "-> min. quality: " << min << std::endl
+           << "-> rebalances: " << _stats.fair_rebalances << " (clients moved: " << _stats.fair_moves << ")" << std::endl;
+        for (const auto& [fd, cl] : _clients) {
+            if (cl.state == Client::State::RUNNING)
+                os << "--> '" << cl.exec << "' [" << cl.pid << "]: " << quality(cl) << std::endl;
+        }
+    }
+
+    void print_mappings() {
+        std::cout << "Currently active mappings:" << std::endl
+                  << "==========================" << std::endl;
+        for (const auto& [name, client] : _clients) {
+            std::cout << "Client '" << client.exec << "' [" << client.pid << "] (ID: " << name << ", priority: "
+                << client.priority << ")" << std::endl;
+            std::cout << "-> mapping: " << client.active_mapping.name << " [" 
+                << client.active_mapping.equivalence_class().name() << "]"
+                << (client.active_mapping.synthesized ? " (synthesized)" : "") << std::endl;
+            if (client.state == Client::State::RUNNING)
+                std::cout << "-> quality: " << quality(client) << std::endl;
+            if (client.slowdown > 1)
+                std::cout << "-> expected slowdown: " << client.slowdown << std::endl;
+            if (client.state == Client::State::SLICED)
+                std::cout << "-> time slot: " << client.slot << (client.stopped ? " (stopped)" : "") << std::endl;
+
+            std::cout << "-> threads:" << std::endl;
+            for (const auto& t : client.threads)
+                std::cout << "--> " << t.name << "(" << t.tid << "): "
+                    << string_util::join(t.cpus.cpulist(num_cpus), ",") << std::endl;
+        }
+        std::cout << "Free cpu(s): " << string_util::join(free_cpus().cpulist(num_cpus), ",") << std::endl;
+        if (_parking.enabled())
+            std::cout << "Parked cpu(s): " << string_util::join(_parking.parked().cpulist(num_cpus), ",") << std::endl;
+        std::cout << "======= END OF LIST =======" << std::endl;
+    } 
+
+    void update_mappings()
+    {
+        _journal.record(Journal::Event::RELOAD, -1, platform->now());
+        logger->info("Update mapping database (%s).\n", _mappings_path.c_str());
+        _mappings.clear();
+
+        try {
+            path_util::for_each_file(_mappings_path, [&](const std::string& file) -> void {
+                if (path_util::extension(file) == ".csv") {
+                    std::string program = string_util::strip(path_util::filename(file));
+                    logger->info(" -> found mapping for '%s'\n", program.c_str());
+
+                    _mappings.emplace(program, parse_mapping(file));
+                }
+            });
+        } catch (std::exception& e) {
+            logger->error("Reading mappings failed with: %s\n", e.what());
+        }
+    }
+};
+
+#endif /* __MANAGER_H__ */
@@ -9,6 +9,8 @@
 #include "equivalence.h"
 
 
+#include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
@@ -30,6 +32,44 @@ int cpu_nr_for_name(const std::string& name)
 } /* Anonymous namespace */
 
 
+/* Characteristic names are mapped to small ids once, so that hot loops can look the
+ * characteristics up by index instead of by name. */
+class CharacteristicIds
+{
+   private:
+    static std::map<std::string, int>& ids()
+    {
+        static std::map<std::string, int> ids;
+        return ids;
+    }
+
+   public:
+    static int id(const std::string& name)
+    {
+        auto& m = ids();
+
+        auto it = m.find(name);
+        if (it != m.end())
+            return it->second;
+
+        int id = static_cast<int>(m.size());
+        m.emplace(name, id);
+
+        return id;
+    }
+
+    static std::string name(int id)
+    {
+        for (const auto& [name, i] : ids()) {
+            if (i == id)
+                return name;
+        }
+
+        return "";
+    }
+};
+
+
 class Mapping
 {
    public:
@@ -38,9 +78,19 @@ class Mapping
     std::map<std::string, double> characteristics_map;
     CPUList         cpus;
 
+    /* The share of a cpu each thread uses, threads without an entry use their cpu fully. */
+    std::map<std::string, double> utilisation_map;
+
+    /* Derived by the server instead of being measured. */
+    bool            synthesized = false;
+
    private:
+    /* The characteristics indexed by their id, NaN if the mapping doesn't have them. */
+    std::vector<double> _values;
+
     Mapping(const Mapping& base, const std::map<int, int>& conv_map) :
-        name{base.name}, thread_map{}, characteristics_map{base.characteristics_map}, cpus{}
+        name{base.name}, thread_map{}, characteristics_map{base.characteristics_map}, cpus{},
+        utilisation_map{base.utilisation_map}, synthesized{base.synthesized}, _values{base._values}
     {
         for (const auto& [name, orig_cpu] : base.thread_map) {
             if (conv_map.find(orig_cpu) != conv_map.end()) {
@@ -58,16 +108,15 @@ class Mapping
 
     Mapping(const std::string& name, const std::vector<std::pair<std::string, std::string>>& threads,
             const std::vector<std::pair<std::string, std::string>>& characteristics) :
-        name{name}, thread_map{}, characteristics_map{}, cpus{}
+        name{name}, thread_map{}, characteristics_map{}, cpus{}, utilisation_map{}, _values{}
     {
         for (const auto& t : threads) {
             thread_map.emplace(t.first, cpu_nr_for_name(t.second));
             cpus.set(cpu_nr_for_name(t.second));
         }
 
-        for (const auto& c : characteristics) {
-            characteristics_map.emplace(c.first, std::stod(c.second));
-        }
+        for (const auto& c : characteristics)
+            set_characteristic(c.first, std::stod(c.second));
     }
 
     CPUList cpu(const std::string& thread) const
@@ -88,6 +137,47 @@ class Mapping
         throw std::runtime_error("Unknown characteristic criteria.");
     }
 
+    /* Lookup by id (see CharacteristicIds), NaN if the mapping doesn't have it. */
+    double characteristic(int id) const
+    {
+        if (id < 0 || static_cast<size_t>(id) >= _values.size())
+            return std::numeric_limits<double>::quiet_NaN();
+
+        return _values[id];
+    }
+
+    void set_characteristic(const std::string& criteria, double value)
+    {
+        characteristics_map[criteria] = value;
+
+        auto id = static_cast<size_t>(CharacteristicIds::id(criteria));
+        if (id >= _values.size())
+            _values.resize(id + 1, std::numeric_limits<double>::quiet_NaN());
+
+        _values[id] = value;
+    }
+
+    /* The share of the given cpu which the threads of this mapping use, at most 1. */
+    double load(int cpu) const
+    {
+        double result = 0;
+        for (const auto& [thread, thread_cpu] : thread_map) {
+            if (thread_cpu != cpu)
+                continue;
+
+            auto it = utilisation_map.find(thread);
+            result += it != utilisation_map.end() ? it->second : 1.0;
+        }
+
+        return std::min(result, 1.0);
+    }
+
+    /* The same mapping with its threads moved according to the given cpu conversion. */
+    Mapping folded(const std::map<int, int>& conv_map) const
+    {
+        return Mapping{*this, conv_map};
+    }
+
     std::vector<Mapping> equivalent_mappings() const
     {
 
@@ -0,0 +1,98 @@
+#ifndef __PARKING_H__
+#define __PARKING_H__
+
+#pragma once
+
+
+#include "config.h"
+#include "cpulist.h"
+#include "path_util.h"
+
+#include <fstream>
+#include <string>
+
+
+class CPUParking
+{
+   private:
+    std::string     _sysfs_root;
+    CPUList         _parked;
+
+    bool set_online(int cpu, bool online)
+    {
+        std::string file = path_util::join(path_util::join(_sysfs_root, "cpu" + std::to_string(cpu)), "online");
+
+        if (!path_util::exists(file))
+            return false;
+
+        std::ofstream f{file};
+        if (!f.is_open())
+            return false;
+
+        f << (online ? "1" : "0") << std::endl;
+
+        return f.good();
+    }
+
+   public:
+    CPUParking() :
+        _sysfs_root{}, _parked{}
+    {}
+
+    explicit CPUParking(const std::string& sysfs_root) :
+        _sysfs_root{sysfs_root}, _parked{}
+    {}
+
+    bool enabled() const
+    {
+        return !_sysfs_root.empty();
+    }
+
+    std::string sysfs_root() const
+    {
+        return _sysfs_root;
+    }
+
+    CPUList parked() const
+    {
+        return _parked;
+    }
+
+    /* Take the given CPUs offline. Returns the CPUs that were newly parked. */
+    CPUList park(const CPUList& cpus)
+    {
+        CPUList result;
+
+        if (!enabled())
+            return result;
+
+        for (auto cpu : cpus.cpulist(num_cpus)) {
+            if ((_parked & CPUList{cpu}).nr_cpus() != 0)
+                continue;
+
+            if (set_online(cpu, false)) {
+                _parked.set(cpu);
+                result.set(cpu);
+            }
+        }
+
+        return result;
+    }
+
+    /* Bring the given CPUs back online. Returns the CPUs that were unparked. */
+    CPUList unpark(const CPUList& cpus)
+    {
+        CPUList result;
+
+        for (auto cpu : (cpus & _parked).cpulist(num_cpus)) {
+            if (set_online(cpu, true)) {
+                _parked.clear(cpu);
+                result.set(cpu);
+            }
+        }
+
+        return result;
+    }
+};
+
+#endif /* __PARKING_H__ */
@@ -0,0 +1,115 @@
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+#pragma once
+
+
+#include "cpulist.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+
+/* The operating system interface of the manager. Everything the manager does to the
+ * clients' processes goes through here, so that it can be replaced for simulations. */
+class Platform
+{
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~Platform() = default;
+
+    virtual Clock::time_point now() const
+    {
+        return Clock::now();
+    }
+
+    virtual bool set_affinity(int tid, const CPUList& cpus)
+    {
+        cpu_set_t mask = cpus.cpu_set();
+        return sched_setaffinity(tid, sizeof(cpu_set_t), &mask) == 0;
+    }
+
+    virtual bool send_signal(int pid, int sig)
+    {
+        return kill(pid, sig) == 0;
+    }
+
+    /* All thread ids of the given process. */
+    virtual std::vector<int> tasks(int pid)
+    {
+        std::vector<int> result;
+        std::string task_dir = "/proc/" + std::to_string(pid) + "/task";
+
+        auto dir = opendir(task_dir.c_str());
+        if (dir == nullptr)
+            return result;
+
+        dirent* cur;
+        while ((cur = readdir(dir)) != nullptr) {
+            if (cur->d_name[0] == '.')
+                continue;
+
+            result.push_back(std::atoi(cur->d_name));
+        }
+
+        closedir(dir);
+
+        return result;
+    }
+
+    /* The process and the user at the other end of a unix socket, false if they are unknown. */
+    virtual bool peer(int fd, int& pid, int& uid)
+    {
+        ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+            return false;
+
+        pid = cred.pid;
+        uid = static_cast<int>(cred.uid);
+        return true;
+    }
+
+    /* The cgroup of a process in the unified hierarchy, or else the one of its cpu controller. */
+    virtual std::string cgroup(int pid)
+    {
+        std::ifstream in{"/proc/" + std::to_string(pid) + "/cgroup"};
+
+        std::string line, result;
+        while (std::getline(in, line)) {
+            /* hierarchy-ID:controller-list:cgroup-path */
+            auto first = line.find(':');
+            auto second = line.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos)
+                continue;
+
+            auto controllers = line.substr(first + 1, second - first - 1);
+            if (controllers.empty())
+                return line.substr(second + 1);
+
+            for (size_t pos = 0; pos != std::string::npos; ) {
+                auto next = controllers.find(',', pos);
+                if (controllers.substr(pos, next == std::string::npos ? next : next - pos) == "cpu")
+                    result = line.substr(second + 1);
+                pos = next == std::string::npos ? next : next + 1;
+            }
+        }
+
+        return result;
+    }
+};
+
+using PlatformPtr = std::shared_ptr<Platform>;
+
+#endif /* __PLATFORM_H__ */
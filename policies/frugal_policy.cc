@@ -0,0 +1,72 @@
+#include "policy.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+/* Among the candidates whose compare criteria is within the tolerance of the best one, the
+ * one with the fewest cpus. That leaves more room for the clients which come later. */
+class FrugalPolicy : public PlacementPolicy
+{
+   private:
+    double          _tolerance;
+
+   public:
+    explicit FrugalPolicy(double tolerance) :
+        _tolerance{tolerance}
+    {}
+
+    std::string name() const override
+    {
+        return "frugal";
+    }
+
+    int choose(const PolicyClient& client, const std::vector<Mapping>& candidates, const Ledger&) override
+    {
+        auto better = [&client](double a, double b) -> bool {
+            return client.more_is_better ? a > b : a < b;
+        };
+
+        int best = -1;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            double v = candidates[i].characteristic(client.criteria_id);
+            if (!std::isnan(v) && (best == -1 || better(v, candidates[best].characteristic(client.criteria_id))))
+                best = static_cast<int>(i);
+        }
+
+        if (best == -1)
+            return -1;
+
+        double limit = candidates[best].characteristic(client.criteria_id);
+        limit = client.more_is_better ? limit - _tolerance * std::abs(limit) : limit + _tolerance * std::abs(limit);
+
+        int result = best;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            double v = candidates[i].characteristic(client.criteria_id);
+            if (std::isnan(v) || better(limit, v))
+                continue;
+
+            if (candidates[i].cpus.nr_cpus() < candidates[result].cpus.nr_cpus())
+                result = static_cast<int>(i);
+        }
+
+        return result;
+    }
+};
+
+extern "C" int tetris_policy_api_version()
+{
+    return TETRIS_POLICY_API_VERSION;
+}
+
+/* The argument is the tolerance as a fraction of the best value (default: 0.1). */
+extern "C" PlacementPolicy* tetris_create_policy(const char* args)
+{
+    double tolerance = 0.1;
+    if (args != nullptr && *args != '\0')
+        tolerance = std::atof(args);
+
+    return new FrugalPolicy{tolerance};
+}
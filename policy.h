@@ -0,0 +1,58 @@
+#ifndef __POLICY_H__
+#define __POLICY_H__
+
+#pragma once
+
+
+#include "ledger.h"
+#include "mapping.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/* What a placement policy knows about the client it places. */
+struct PolicyClient
+{
+    std::string     exec;
+    int             pid;
+    bool            dynamic_client;
+    int             priority;
+    bool            exclusive;
+    std::string     group;
+
+    /* The compare criteria of the client. Policies in shared objects must use the id to look
+     * up characteristics (Mapping::characteristic(int)), they don't share the server's ids. */
+    std::string     criteria;
+    int             criteria_id;
+    bool            more_is_better;
+};
+
+/* Chooses the mapping of a client among the candidates, which all fit onto the cpus left
+ * by the other clients and satisfy the client's filter.
+ *
+ * Policies can be loaded from shared objects, which export the two functions
+ *
+ *     extern "C" int tetris_policy_api_version();      returning TETRIS_POLICY_API_VERSION
+ *     extern "C" PlacementPolicy* tetris_create_policy(const char* args);
+ *
+ * The server deletes the returned policy before it unloads the shared object. The interface
+ * passes C++ types, so policies have to be built with the same compiler, standard library
+ * and flags as the server. The version only covers the layout of these declarations. */
+class PlacementPolicy
+{
+   public:
+    virtual ~PlacementPolicy() = default;
+
+    virtual std::string name() const = 0;
+
+    /* The index of the chosen candidate, or -1 if none of them is acceptable. */
+    virtual int choose(const PolicyClient& client, const std::vector<Mapping>& candidates, const Ledger& ledger) = 0;
+};
+
+using PlacementPolicyPtr = std::shared_ptr<PlacementPolicy>;
+
+constexpr int TETRIS_POLICY_API_VERSION = 2;
+
+#endif /* __POLICY_H__ */
@@ -0,0 +1,182 @@
+#ifndef __QUOTA_H__
+#define __QUOTA_H__
+
+#pragma once
+
+
+#include "config.h"
+#include "cpulist.h"
+#include "string_util.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pwd.h>
+#include <sys/types.h>
+
+
+/* The limits of the clients of one user or cgroup together, negative values don't limit. */
+struct Quota
+{
+    std::map<std::string, int> cluster_cpus;
+    int             cpus = -1;
+    double          energy_share = -1;
+
+    std::string repr() const
+    {
+        std::vector<std::string> terms;
+        for (const auto& [cluster, n] : cluster_cpus)
+            terms.push_back(cluster + "=" + std::to_string(n));
+        if (cpus >= 0)
+            terms.push_back("cpus=" + std::to_string(cpus));
+        if (energy_share >= 0)
+            terms.push_back("energy=" + std::to_string(energy_share));
+
+        return string_util::join(terms, " ");
+    }
+};
+
+/* The quotas of users and cgroups, read from a file with one quota per line:
+ *
+ *     user    alice               big=2 little=4
+ *     user    1001                cpus=4 energy=0.25
+ *     user    *                   big=4
+ *     cgroup  /system.slice/batch big=1
+ *
+ * Users are given by name or uid, '*' applies to every user without a quota of their own.
+ * A cgroup quota applies to all clients in the cgroup and below it together. */
+class Quotas
+{
+   private:
+    std::map<std::string, Quota> _users;
+    std::map<std::string, Quota> _cgroups;
+
+    static Quota parse_limits(const std::vector<std::string>& terms, const std::string& line)
+    {
+        Quota q;
+        for (const auto& term : terms) {
+            auto parts = string_util::split(term, '=');
+            if (parts.size() != 2)
+                throw std::runtime_error{"Malformed quota: " + line};
+
+            auto key = string_util::strip(parts[0]);
+            try {
+                if (key == "cpus") {
+                    q.cpus = std::stoi(parts[1]);
+                } else if (key == "energy") {
+                    q.energy_share = std::stod(parts[1]);
+                } else {
+                    auto it = std::find_if(clusters.begin(), clusters.end(), [&](const Cluster& c) { return c.name == key; });
+                    if (it == clusters.end())
+                        throw std::runtime_error{"Unknown cpu class '" + key + "' in quota: " + line};
+
+                    q.cluster_cpus[key] = std::stoi(parts[1]);
+                }
+            } catch (std::logic_error&) {
+                throw std::runtime_error{"Malformed quota: " + line};
+            }
+        }
+
+        return q;
+    }
+
+   public:
+    Quotas() :
+        _users{}, _cgroups{}
+    {}
+
+    bool empty() const
+    {
+        return _users.empty() && _cgroups.empty();
+    }
+
+    void load(const std::string& path)
+    {
+        std::ifstream in{path};
+        if (!in.is_open())
+            throw std::runtime_error{"Failed to open quota file " + path};
+
+        _users.clear();
+        _cgroups.clear();
+
+        std::string line;
+        while (std::getline(in, line)) {
+            std::replace(line.begin(), line.end(), '\t', ' ');
+            line = string_util::strip(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+
+            std::vector<std::string> fields;
+            for (const auto& f : string_util::split(line, ' ')) {
+                if (!string_util::strip(f).empty())
+                    fields.push_back(string_util::strip(f));
+            }
+
+            if (fields.size() < 3)
+                throw std::runtime_error{"Malformed quota: " + line};
+
+            auto quota = parse_limits({fields.begin() + 2, fields.end()}, line);
+            if (fields[0] == "user")
+                _users[fields[1]] = quota;
+            else if (fields[0] == "cgroup")
+                _cgroups[fields[1]] = quota;
+            else
+                throw std::runtime_error{"Unknown quota kind '" + fields[0] + "': " + line};
+        }
+    }
+
+    /* The quota of a user, by name before uid before the default one. */
+    const Quota* user(int uid, const std::string& name) const
+    {
+        if (uid < 0)
+            return nullptr;
+
+        for (const auto& key : {name, std::to_string(uid), std::string{"*"}}) {
+            auto it = _users.find(key);
+            if (!key.empty() && it != _users.end())
+                return &it->second;
+        }
+
+        return nullptr;
+    }
+
+    /* The cgroup whose quota applies to the given one, the innermost one with a quota. */
+    std::string cgroup_of(const std::string& cgroup) const
+    {
+        std::string result;
+        for (const auto& [path, q] : _cgroups) {
+            bool below = cgroup == path || (cgroup.compare(0, path.size(), path) == 0 &&
+                    (path.back() == '/' || cgroup[path.size()] == '/'));
+            if (below && path.size() > result.size())
+                result = path;
+        }
+
+        return result;
+    }
+
+    const Quota* cgroup(const std::string& path) const
+    {
+        auto it = _cgroups.find(path);
+        return it != _cgroups.end() ? &it->second : nullptr;
+    }
+
+    static std::string user_name(int uid)
+    {
+        if (uid < 0)
+            return "";
+
+        passwd pw;
+        passwd* result = nullptr;
+        char buf[1024];
+        if (getpwuid_r(static_cast<uid_t>(uid), &pw, buf, sizeof(buf), &result) != 0 || result == nullptr)
+            return std::to_string(uid);
+
+        return pw.pw_name;
+    }
+};
+
+#endif /* __QUOTA_H__ */
@@ -0,0 +1,464 @@
+#ifndef __SERVER_CONFIG_H__
+#define __SERVER_CONFIG_H__
+
+#pragma once
+
+
+#include "config.h"
+#include "path_util.h"
+#include "string_util.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+
+/***
+ * Server configuration
+ ***/
+
+enum class QueueOrder
+{
+    FIFO,
+    SHORTEST_FIRST,
+    BEST_FIT
+};
+
+struct ServerConfig
+{
+    bool            compact = false;
+    bool            park_cpus = false;
+    std::string     sysfs_root = "/sys/devices/system/cpu";
+
+    bool            queue = false;
+    QueueOrder      queue_order = QueueOrder::FIFO;
+
+    double          max_suspend_s = 60;
+
+    double          max_degradation = 0;
+
+    bool            predict = false;
+    double          predict_horizon_s = 0;
+    double          predict_threshold = 0.5;
+
+    double          energy_budget = 0;
+    std::string     budget_criteria = "energyConsumption";
+
+    std::string     journal_path;
+
+    double          deadline_s = 0;
+    bool            refine = false;
+
+    bool            upgrade = false;
+    double          upgrade_hysteresis = 0;
+    double          upgrade_interval_s = 10;
+
+    bool            fair = false;
+
+    /* Characteristics of synthesized mappings are scaled by (original cpus / cpus)^exponent. */
+    bool            synthesize = false;
+    std::map<std::string, double> synth_model = {{"executionTime", 1}};
+
+    /* Maximum summed utilisation of a cpu shared by several clients, 0 keeps cpus exclusive. */
+    double          colocate_limit = 0;
+
+    /* Clients without a free mapping get one in a time slot, the slots take turns. */
+    bool            timeslice = false;
+    double          quantum_s = 0.1;
+    int             max_slots = 4;
+
+    /* Clients arriving within the window are placed jointly at its end. */
+    double          batch_window_s = 0;
+
+    /* Maximum time the members of a group wait for the missing ones. */
+    double          group_timeout_s = 5;
+
+    /* A shared object with a placement policy, or the name of a built-in one. */
+    std::string     policy = "greedy";
+    std::string     policy_args;
+
+    /* Programs sometimes run on a near-best mapping to learn which one is actually fastest. */
+    bool            explore = false;
+    double          explore_rate = 0.1;
+    std::map<std::string, double> explore_rates;
+    double          explore_tolerance = 0.2;
+    std::string     explore_criteria = "executionTime";
+    std::string     explore_state_path;
+    long            explore_seed = -1;      /* Negative for a random seed */
+
+    /* Limits of the clients of each user and cgroup. */
+    std::string     quota_path;
+
+    /* Capacities of further packing dimensions in the unit of their characteristic, for the
+     * whole machine (key "") or per cluster. Empty if the dimension isn't packed. */
+    std::map<std::string, double> memory_capacity;
+    std::string     memory_criteria = "memorySize";
+    std::map<std::string, double> bandwidth_capacity;
+    std::string     bandwidth_criteria = "memoryBandwidth";
+
+    /* Slowdowns of programs sharing a cluster, configured and/or learned, which scale the
+     * characteristic of candidates next to other clients. */
+    std::string     interference_path;
+    bool            interference_learn = false;
+    std::string     interference_criteria = "executionTime";
+};
+
+inline std::string queue_order_name(QueueOrder order)
+{
+    switch (order) {
+        case QueueOrder::FIFO:
+            return "fifo";
+        case QueueOrder::SHORTEST_FIRST:
+            return "sjf";
+        case QueueOrder::BEST_FIT:
+            return "bestfit";
+    }
+
+    return "unknown";
+}
+
+/***
+ * Command line options
+ ***/
+
+enum class OptionState
+{
+    OK,         /* The option was consumed */
+    UNKNOWN,    /* The option is not a server option */
+    INVALID     /* The option is a server option, but its value is missing or malformed */
+};
+
+inline void server_options_usage(std::ostream& os)
+{
+    os << "   --compact            pack clients onto few clusters when clients leave." << std::endl
+        << "   --park-cpus          take fully free cpus offline." << std::endl
+        << "   --sysfs-root PATH    sysfs cpu directory used for parking (default: /sys/devices/system/cpu)." << std::endl
+        << "   --queue ORDER        queue clients without fitting mapping (ORDER: fifo, sjf or bestfit)." << std::endl
+        << "   --max-suspend SEC    maximum time a suspended client waits for a mapping (default: 60)." << std::endl
+        << "   --max-degradation F  default relative degradation a client accepts to make room (default: 0)." << std::endl
+        << "   --predict SEC        keep headroom for programs likely to arrive within SEC seconds." << std::endl
+        << "   --predict-threshold P  arrival probability from which headroom is kept (default: 0.5)." << std::endl
+        << "   --energy-budget E    maximum sum of the clients' energy characteristic." << std::endl
+        << "   --budget-criteria C  characteristic used for the energy budget (default: energyConsumption)." << std::endl
+        << "   --journal FILE       record all input events of the manager in FILE." << std::endl
+        << "   --deadline SEC       stop the search for a new client's mapping after SEC seconds." << std::endl
+        << "   --refine             complete searches stopped at the deadline once the client runs." << std::endl
+        << "   --upgrade F          move running clients to mappings more than F better when cpus free up." << std::endl
+        << "   --upgrade-interval SEC  minimum time between two upgrades of a client (default: 10)." << std::endl
+        << "   --fair               maximize the minimum quality of the clients' mappings." << std::endl
+        << "   --synthesize         fold the closest stored mapping onto the free cpus if none fits." << std::endl
+        << "   --synth-model SPEC   scaling exponents of synthesized characteristics (default: executionTime=1)." << std::endl
+        << "   --colocate LIMIT     share cpus between clients up to a summed utilisation of LIMIT." << std::endl
+        << "   --timeslice SEC      rotate clients without a free mapping in time slots of SEC seconds." << std::endl
+        << "   --max-slots N        maximum number of time slots including the running clients (default: 4)." << std::endl
+        << "   --batch SEC          place clients arriving within SEC seconds jointly." << std::endl
+        << "   --group-timeout SEC  time a group waits for missing members before it is placed (default: 5)." << std::endl
+        << "   --policy FILE        placement policy, a shared object or 'greedy' (default: greedy)." << std::endl
+        << "   --policy-args ARGS   arguments passed to the placement policy." << std::endl
+        << "   --explore RATE       learn the fastest mappings from observed runtimes, exploring in RATE of the runs." << std::endl
+        << "   --explore-rates SPEC exploration rates of single programs (e.g. jpeg=0.5,htop=0)." << std::endl
+        << "   --explore-tolerance F  maximum predicted degradation of an explored mapping (default: 0.2)." << std::endl
+        << "   --explore-criteria C characteristic the observed runtime corresponds to (default: executionTime)." << std::endl
+        << "   --explore-state FILE keep the observed runtimes in FILE across restarts." << std::endl
+        << "   --explore-seed N     seed of the exploration's random draws (default: random)." << std::endl
+        << "   --quotas FILE        limit the cpus and energy share of users and cgroups as given in FILE." << std::endl
+        << "   --memory SPEC        memory capacity of the machine (e.g. 4096) or its clusters (e.g. little=2048,big=2048)." << std::endl
+        << "   --memory-criteria C  characteristic holding the memory demand (default: memorySize)." << std::endl
+        << "   --bandwidth SPEC     memory bandwidth capacity of the machine or its clusters." << std::endl
+        << "   --bandwidth-criteria C  characteristic holding the bandwidth demand (default: memoryBandwidth)." << std::endl
+        << "   --interference FILE  slowdowns of programs sharing a cluster as given in FILE." << std::endl
+        << "   --learn-interference learn the slowdowns from the observed runtimes." << std::endl
+        << "   --interference-criteria C  characteristic the slowdowns apply to (default: executionTime)." << std::endl;
+}
+
+/* Parse the option at argv[i] into the configuration. Options with a value advance i. */
+inline OptionState parse_server_option(int argc, char* argv[], int& i, ServerConfig& config)
+{
+    std::string arg{argv[i]};
+
+    auto value = [&]() -> const char* {
+        if (i + 1 == argc) {
+            std::cout << "Missing value for option: " << arg << std::endl;
+            return nullptr;
+        }
+
+        return argv[++i];
+    };
+
+    /* A capacity of the whole machine, or a comma separated list of cluster=capacity. */
+    auto capacity = [&](std::map<std::string, double>& target) -> bool {
+        auto v = value();
+        if (v == nullptr)
+            return false;
+
+        target.clear();
+        try {
+            std::string spec{v};
+            if (spec.find('=') == std::string::npos) {
+                target[""] = std::stod(spec);
+                return true;
+            }
+
+            for (const auto& term : string_util::split(spec, ',')) {
+                auto parts = string_util::split(term, '=');
+                if (parts.size() != 2)
+                    throw std::invalid_argument{term};
+
+                auto name = string_util::strip(parts[0]);
+                if (std::none_of(clusters.begin(), clusters.end(), [&](const Cluster& c) { return c.name == name; }))
+                    throw std::invalid_argument{name};
+
+                target[name] = std::stod(parts[1]);
+            }
+        } catch (std::exception&) {
+            std::cout << "Malformed capacity for option " << arg << ": " << v << std::endl;
+            return false;
+        }
+
+        return true;
+    };
+
+    auto number = [&](double& target) -> bool {
+        auto v = value();
+        if (v == nullptr)
+            return false;
+
+        try {
+            target = std::stod(v);
+        } catch (std::exception&) {
+            std::cout << "Malformed value for option " << arg << ": " << v << std::endl;
+            return false;
+        }
+
+        return true;
+    };
+
+    if (arg == "--compact") {
+        config.compact = true;
+    } else if (arg == "--park-cpus") {
+        config.park_cpus = true;
+    } else if (arg == "--sysfs-root") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.sysfs_root = path_util::abspath(path_util::expanduser(v));
+    } else if (arg == "--queue") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        std::string order{v};
+        if (order == "fifo") {
+            config.queue_order = QueueOrder::FIFO;
+        } else if (order == "sjf") {
+            config.queue_order = QueueOrder::SHORTEST_FIRST;
+        } else if (order == "bestfit") {
+            config.queue_order = QueueOrder::BEST_FIT;
+        } else {
+            std::cout << "Unknown queue order: " << order << std::endl;
+            return OptionState::INVALID;
+        }
+
+        config.queue = true;
+    } else if (arg == "--max-degradation") {
+        if (!number(config.max_degradation))
+            return OptionState::INVALID;
+    } else if (arg == "--predict") {
+        if (!number(config.predict_horizon_s))
+            return OptionState::INVALID;
+
+        config.predict = true;
+    } else if (arg == "--predict-threshold") {
+        if (!number(config.predict_threshold))
+            return OptionState::INVALID;
+    } else if (arg == "--energy-budget") {
+        if (!number(config.energy_budget))
+            return OptionState::INVALID;
+    } else if (arg == "--budget-criteria") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.budget_criteria = v;
+    } else if (arg == "--max-suspend") {
+        if (!number(config.max_suspend_s))
+            return OptionState::INVALID;
+    } else if (arg == "--deadline") {
+        if (!number(config.deadline_s))
+            return OptionState::INVALID;
+    } else if (arg == "--refine") {
+        config.refine = true;
+    } else if (arg == "--upgrade") {
+        if (!number(config.upgrade_hysteresis))
+            return OptionState::INVALID;
+
+        config.upgrade = true;
+    } else if (arg == "--upgrade-interval") {
+        if (!number(config.upgrade_interval_s))
+            return OptionState::INVALID;
+    } else if (arg == "--fair") {
+        config.fair = true;
+    } else if (arg == "--synthesize") {
+        config.synthesize = true;
+    } else if (arg == "--synth-model") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        /* A comma separated list of characteristic=exponent. */
+        config.synth_model.clear();
+        for (const auto& term : string_util::split(v, ',')) {
+            auto parts = string_util::split(term, '=');
+            try {
+                if (parts.size() != 2)
+                    throw std::invalid_argument{term};
+
+                config.synth_model[string_util::strip(parts[0])] = std::stod(parts[1]);
+            } catch (std::exception&) {
+                std::cout << "Malformed scaling model: " << v << std::endl;
+                return OptionState::INVALID;
+            }
+        }
+    } else if (arg == "--colocate") {
+        if (!number(config.colocate_limit))
+            return OptionState::INVALID;
+    } else if (arg == "--timeslice") {
+        if (!number(config.quantum_s))
+            return OptionState::INVALID;
+
+        /* Slots of no length would be rotated all the time. */
+        if (config.quantum_s <= 0) {
+            std::cout << "The time slot length has to be positive: " << argv[i] << std::endl;
+            return OptionState::INVALID;
+        }
+
+        config.timeslice = true;
+    } else if (arg == "--max-slots") {
+        double slots;
+        if (!number(slots))
+            return OptionState::INVALID;
+
+        if (slots <= 0) {
+            std::cout << "The number of time slots has to be positive: " << argv[i] << std::endl;
+            return OptionState::INVALID;
+        }
+
+        config.max_slots = static_cast<int>(slots);
+    } else if (arg == "--batch") {
+        if (!number(config.batch_window_s))
+            return OptionState::INVALID;
+    } else if (arg == "--group-timeout") {
+        if (!number(config.group_timeout_s))
+            return OptionState::INVALID;
+    } else if (arg == "--policy") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        std::string policy{v};
+        config.policy = policy == "greedy" ? policy : path_util::abspath(path_util::expanduser(policy));
+    } else if (arg == "--policy-args") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.policy_args = v;
+    } else if (arg == "--explore") {
+        if (!number(config.explore_rate))
+            return OptionState::INVALID;
+
+        config.explore = true;
+    } else if (arg == "--explore-rates") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        /* A comma separated list of program=rate. */
+        for (const auto& term : string_util::split(v, ',')) {
+            auto parts = string_util::split(term, '=');
+            try {
+                if (parts.size() != 2)
+                    throw std::invalid_argument{term};
+
+                config.explore_rates[string_util::strip(parts[0])] = std::stod(parts[1]);
+            } catch (std::exception&) {
+                std::cout << "Malformed exploration rates: " << v << std::endl;
+                return OptionState::INVALID;
+            }
+        }
+    } else if (arg == "--explore-tolerance") {
+        if (!number(config.explore_tolerance))
+            return OptionState::INVALID;
+    } else if (arg == "--explore-criteria") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.explore_criteria = v;
+    } else if (arg == "--explore-state") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.explore_state_path = path_util::abspath(path_util::expanduser(v));
+    } else if (arg == "--explore-seed") {
+        double seed;
+        if (!number(seed))
+            return OptionState::INVALID;
+
+        config.explore_seed = static_cast<long>(seed);
+    } else if (arg == "--quotas") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.quota_path = path_util::abspath(path_util::expanduser(v));
+    } else if (arg == "--memory") {
+        if (!capacity(config.memory_capacity))
+            return OptionState::INVALID;
+    } else if (arg == "--memory-criteria") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.memory_criteria = v;
+    } else if (arg == "--bandwidth") {
+        if (!capacity(config.bandwidth_capacity))
+            return OptionState::INVALID;
+    } else if (arg == "--bandwidth-criteria") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.bandwidth_criteria = v;
+    } else if (arg == "--interference") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.interference_path = path_util::abspath(path_util::expanduser(v));
+    } else if (arg == "--learn-interference") {
+        config.interference_learn = true;
+    } else if (arg == "--interference-criteria") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.interference_criteria = v;
+    } else if (arg == "--journal") {
+        auto v = value();
+        if (v == nullptr)
+            return OptionState::INVALID;
+
+        config.journal_path = path_util::abspath(path_util::expanduser(v));
+    } else {
+        return OptionState::UNKNOWN;
+    }
+
+    return OptionState::OK;
+}
+
+#endif /* __SERVER_CONFIG_H__ */
@@ -16,6 +16,11 @@ struct ControlData {
         UPDATE_CLIENT = 1,
         UPDATE_MAPPINGS = 2,
         BLOCK_CPUS = 3,
+        STATS = 4,
+        ENERGY_BUDGET = 5,
+        RESERVE = 6,
+        UNRESERVE = 7,
+        RESERVATIONS = 8,
         ERROR
     };
 
@@ -31,14 +36,36 @@ struct ControlData {
             bool has_preferred_mapping;
             char preferred_mapping[25];
             bool has_filter_criteria;
-            char filter_criteria[50];
+            char filter_criteria[256];
+            bool has_priority;
+            int priority;
+            bool has_max_degradation;
+            double max_degradation;
         } update_data;
         struct {
             cpu_set_t cpus;
         } block_cpus_data;
+        struct {
+            bool set;
+            double budget;
+        } energy_budget_data;
+        struct {
+            char job[32];
+            cpu_set_t cpus;         /* The cpus to reserve, or if empty */
+            int count;              /* the number of cpus of the cluster */
+            char cluster[16];
+            double start_s;         /* From now */
+            double ttl_s;           /* From the start, 0 keeps the reservation until it is released */
+            int priority;
+        } reserve_data;
     };
 };
 
+struct ControlReply {
+    bool last;
+    char text[1000];
+};
+
 struct TetrisData {
     enum Operations {
         NEW_CLIENT = 1,
@@ -48,6 +75,11 @@ struct TetrisData {
         ERROR
     };
 
+    enum Admission {
+        DEFAULT = 0,
+        SUSPEND = 1
+    };
+
     Operations op;
     union {
         struct {
@@ -59,7 +91,14 @@ struct TetrisData {
             bool has_preferred_mapping;
             char preferred_mapping[25];
             bool has_filter_criteria;
-            char filter_criteria[50];
+            char filter_criteria[256];
+            Admission admission;
+            int priority;
+            bool has_max_degradation;
+            double max_degradation;
+            bool exclusive;
+            char group[32];
+            int group_size;
         } new_client_data;
         struct {
             int id;
@@ -6,6 +6,7 @@
 #include <atomic>
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <mutex>
@@ -108,7 +109,8 @@ std::atomic_ulong time_ns;
 static
 bool tetris_new_client(LockedConnection conn, int pid, const char* exec, char* mapping_type,
         const char* compare_criteria, bool compare_more_is_better, const char* preferred_mapping,
-        const char* filter_criteria) {
+        const char* filter_criteria, const char* admission, const char* priority, const char* max_degradation,
+        bool exclusive, const char* group, const char* group_size) {
     TetrisData data;
 
     /* Send the new-client message to the server. */
@@ -152,11 +154,47 @@ bool tetris_new_client(LockedConnection conn, int pid, const char* exec, char* m
 
     if (filter_criteria) {
         data.new_client_data.has_filter_criteria = true;
-        std::strncpy(data.new_client_data.filter_criteria, filter_criteria, sizeof(data.new_client_data.filter_criteria));
+        std::strncpy(data.new_client_data.filter_criteria, filter_criteria, sizeof(data.new_client_data.filter_criteria) - 1);
     } else {
         data.new_client_data.has_filter_criteria = false;
     }
 
+    data.new_client_data.admission = TetrisData::Admission::DEFAULT;
+    if (admission) {
+        if (strcmp(admission, "SUSPEND") == 0) {
+            logger->info("Suspend until a mapping fits.\n");
+            data.new_client_data.admission = TetrisData::Admission::SUSPEND;
+        } else if (strcmp(admission, "DEFAULT") != 0) {
+            logger->warning("Unknown admission mode: %s\n", admission);
+        }
+    }
+
+    data.new_client_data.priority = 0;
+    if (priority) {
+        data.new_client_data.priority = std::atoi(priority);
+        logger->info("Use priority -- %d.\n", data.new_client_data.priority);
+    }
+
+    if (max_degradation) {
+        data.new_client_data.has_max_degradation = true;
+        data.new_client_data.max_degradation = std::atof(max_degradation);
+    } else {
+        data.new_client_data.has_max_degradation = false;
+    }
+
+    if (exclusive)
+        logger->info("Use cpus exclusively.\n");
+    data.new_client_data.exclusive = exclusive;
+
+    std::memset(data.new_client_data.group, 0, sizeof(data.new_client_data.group));
+    data.new_client_data.group_size = 0;
+    if (group) {
+        std::strncpy(data.new_client_data.group, group, sizeof(data.new_client_data.group) - 1);
+        if (group_size)
+            data.new_client_data.group_size = std::atoi(group_size);
+        logger->info("Use group -- %s (%d member(s)).\n", data.new_client_data.group, data.new_client_data.group_size);
+    }
+
     if (conn->write(data) != Connection::OutState::DONE) {
         logger->error("Failed to send new-client message.\n");
         return false;
@@ -238,8 +276,21 @@ void __attribute__((constructor)) setup(void)
 
         char *filter_criteria = getenv("TETRIS_FILTER_CRITERIA");
 
+        char *admission = getenv("TETRIS_ADMISSION");
+
+        char *priority = getenv("TETRIS_PRIORITY");
+        char *max_degradation = getenv("TETRIS_MAX_DEGRADATION");
+
+        bool exclusive = false;
+        if (getenv("TETRIS_EXCLUSIVE"))
+            exclusive = true;
+
+        char *group = getenv("TETRIS_GROUP");
+        char *group_size = getenv("TETRIS_GROUP_SIZE");
+
         if (tetris_new_client(connection->locked(), pid, exec, mapping_type, compare_criteria,
-                    compare_more_is_better, preferred_mapping, filter_criteria)) {
+                    compare_more_is_better, preferred_mapping, filter_criteria, admission, priority,
+                    max_degradation, exclusive, group, group_size)) {
             logger->info("->> Managed by TETRIS <<-\n");
             managed_by_tetris = true;
         } else {
@@ -13,6 +13,21 @@
 #include <cstring>
 
 
+void print_reply(Connection& conn)
+{
+    /* The server answers with text chunks until the last one is marked. */
+    ControlReply reply;
+
+    do {
+        std::memset(&reply, 0, sizeof(reply));
+        if (conn.read(reply) != Connection::InState::DONE)
+            throw std::runtime_error("Failed to read reply from server.");
+
+        reply.text[sizeof(reply.text) - 1] = '\0';
+        std::cout << reply.text;
+    } while (!reply.last);
+}
+
 void usage_upd_client()
 {
     std::cout << "usage: tetrisctl upd_client [-h] ID" << std::endl
@@ -28,7 +43,9 @@ void usage_upd_client()
         << " TETRIS_PREFERRED_MAPPING" << std::endl
         << " TETRIS_COMPARE_CRITERIA" << std::endl
         << " TETRIS_COMPARE_MORE_IS_BETTER" << std::endl
-        << " TETRIS_FILTER_CRITERIA" << std::endl;
+        << " TETRIS_FILTER_CRITERIA" << std::endl
+        << " TETRIS_PRIORITY" << std::endl
+        << " TETRIS_MAX_DEGRADATION" << std::endl;
 }
 
 int op_update_client(int argc, char* argv[])
@@ -66,6 +83,9 @@ try {
 
     char *filter_criteria = getenv("TETRIS_FILTER_CRITERIA");
 
+    char *priority = getenv("TETRIS_PRIORITY");
+    char *max_degradation = getenv("TETRIS_MAX_DEGRADATION");
+
     /* Connect to the server and transmit the data */
     auto conn = std::make_unique<Connection>(CONTROL_SOCKET);
     ControlData cd;
@@ -97,10 +117,22 @@ try {
 
     if (filter_criteria) {
         cd.update_data.has_filter_criteria = true;
-        std::strncpy(cd.update_data.filter_criteria, filter_criteria, sizeof(cd.update_data.filter_criteria));
+        std::strncpy(cd.update_data.filter_criteria, filter_criteria, sizeof(cd.update_data.filter_criteria) - 1);
     } else
         cd.update_data.has_filter_criteria = false;
 
+    if (priority) {
+        cd.update_data.has_priority = true;
+        cd.update_data.priority = std::atoi(priority);
+    } else
+        cd.update_data.has_priority = false;
+
+    if (max_degradation) {
+        cd.update_data.has_max_degradation = true;
+        cd.update_data.max_degradation = std::atof(max_degradation);
+    } else
+        cd.update_data.has_max_degradation = false;
+
     conn->write(cd);
 
     return 0;
@@ -272,6 +304,272 @@ try {
     cd.block_cpus_data.cpus = cpus.cpu_set();
 
     conn->write(cd);
+    print_reply(*conn);
+
+    return 0;
+} catch (std::runtime_error& e) {
+    std::cout << "Something went wrong: " << e.what() << std::endl;
+    return 1;
+}
+
+void usage_stats()
+{
+    std::cout << "usage: tetrisctl stats [-h]" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "   -h, --help           show this help message" << std::endl;
+}
+
+int op_stats(int argc, char* argv[])
+try {
+    if (argc > 3) {
+        usage_stats();
+        return 1;
+    } else if (argc == 3) {
+        std::string arg{argv[2]};
+
+        if (arg == "-h" || arg == "--help") {
+            usage_stats();
+            return 0;
+        } else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            usage_stats();
+            return 1;
+        }
+    }
+
+    /* Connect to the server and ask for its statistics */
+    auto conn = std::make_unique<Connection>(CONTROL_SOCKET);
+    ControlData cd;
+
+    cd.op = ControlData::Operations::STATS;
+
+    conn->write(cd);
+    print_reply(*conn);
+
+    return 0;
+} catch (std::runtime_error& e) {
+    std::cout << "Something went wrong: " << e.what() << std::endl;
+    return 1;
+}
+
+void usage_energy_budget()
+{
+    std::cout << "usage: tetrisctl energy_budget [-h] [BUDGET]" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "   -h, --help           show this help message" << std::endl
+        << std::endl
+        << "Positionals:" << std::endl
+        << " BUDGET                 the new energy budget (0 disables it), if omitted show the budget ledger" << std::endl;
+}
+
+int op_energy_budget(int argc, char* argv[])
+try {
+    ControlData cd;
+
+    cd.op = ControlData::Operations::ENERGY_BUDGET;
+    cd.energy_budget_data.set = false;
+
+    if (argc > 3) {
+        usage_energy_budget();
+        return 1;
+    } else if (argc == 3) {
+        std::string arg{argv[2]};
+
+        if (arg == "-h" || arg == "--help") {
+            usage_energy_budget();
+            return 0;
+        } else {
+            try {
+                cd.energy_budget_data.budget = std::stod(arg);
+                cd.energy_budget_data.set = true;
+            } catch (const std::exception&) {
+                std::cout << "Malformed budget: " << arg << std::endl;
+                usage_energy_budget();
+                return 1;
+            }
+        }
+    }
+
+    /* Connect to the server and transmit the data */
+    auto conn = std::make_unique<Connection>(CONTROL_SOCKET);
+
+    conn->write(cd);
+    print_reply(*conn);
+
+    return 0;
+} catch (std::runtime_error& e) {
+    std::cout << "Something went wrong: " << e.what() << std::endl;
+    return 1;
+}
+
+void usage_reserve()
+{
+    std::cout << "usage: tetrisctl reserve [-h] [-n N] [-c CLASS] [-s SEC] [-t SEC] [-p PRIO] JOB [CPUS]" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "   -h, --help           show this help message" << std::endl
+        << "   -n, --count N        the number of cpus to reserve, if no CPUS are given (default: 1)" << std::endl
+        << "   -c, --class CLASS    the cluster the cpus are taken from (default: any)" << std::endl
+        << "   -s, --start SEC      the start of the reservation in SEC seconds (default: 0)" << std::endl
+        << "   -t, --ttl SEC        release the reservation SEC seconds after its start (default: never)" << std::endl
+        << "   -p, --priority PRIO  reservations of a lower priority make room (default: 0)" << std::endl
+        << std::endl
+        << "Positionals:" << std::endl
+        << " JOB                    the name of the job the cpus are reserved for, reserving again renews it" << std::endl
+        << " CPUS                   the list of CPUs that should be reserved" << std::endl;
+}
+
+int op_reserve(int argc, char* argv[])
+try {
+    ControlData cd;
+    std::memset(&cd, 0, sizeof(cd));
+
+    cd.op = ControlData::Operations::RESERVE;
+    cd.reserve_data.count = 1;
+
+    std::string job;
+    CPUList cpus;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg{argv[i]};
+
+        if (arg == "-h" || arg == "--help") {
+            usage_reserve();
+            return 0;
+        }
+
+        bool has_value = arg == "-n" || arg == "--count" || arg == "-c" || arg == "--class" || arg == "-s" ||
+            arg == "--start" || arg == "-t" || arg == "--ttl" || arg == "-p" || arg == "--priority";
+        if (has_value && i + 1 == argc) {
+            std::cout << "Missing value for option: " << arg << std::endl;
+            usage_reserve();
+            return 1;
+        }
+
+        try {
+            if (arg == "-n" || arg == "--count") {
+                cd.reserve_data.count = std::stoi(argv[++i]);
+            } else if (arg == "-c" || arg == "--class") {
+                std::strncpy(cd.reserve_data.cluster, argv[++i], sizeof(cd.reserve_data.cluster) - 1);
+            } else if (arg == "-s" || arg == "--start") {
+                cd.reserve_data.start_s = std::stod(argv[++i]);
+            } else if (arg == "-t" || arg == "--ttl") {
+                cd.reserve_data.ttl_s = std::stod(argv[++i]);
+            } else if (arg == "-p" || arg == "--priority") {
+                cd.reserve_data.priority = std::stoi(argv[++i]);
+            } else if (job.empty()) {
+                job = arg;
+            } else if (cpus.nr_cpus() == 0) {
+                cpus = parse_cpu_list(arg);
+            } else {
+                std::cout << "Unknown option: " << arg << std::endl;
+                usage_reserve();
+                return 1;
+            }
+        } catch (std::exception&) {
+            std::cout << "Malformed value for option " << arg << ": " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (job.empty() || job.size() >= sizeof(cd.reserve_data.job)) {
+        usage_reserve();
+        return 1;
+    }
+
+    std::strncpy(cd.reserve_data.job, job.c_str(), sizeof(cd.reserve_data.job) - 1);
+    cd.reserve_data.cpus = cpus.cpu_set();
+
+    /* Connect to the server and transmit the data */
+    auto conn = std::make_unique<Connection>(CONTROL_SOCKET);
+
+    conn->write(cd);
+    print_reply(*conn);
+
+    return 0;
+} catch (std::runtime_error& e) {
+    std::cout << "Something went wrong: " << e.what() << std::endl;
+    return 1;
+}
+
+void usage_unreserve()
+{
+    std::cout << "usage: tetrisctl unreserve [-h] JOB" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "   -h, --help           show this help message" << std::endl
+        << std::endl
+        << "Positionals:" << std::endl
+        << " JOB                    the job whose reservation is released" << std::endl;
+}
+
+int op_unreserve(int argc, char* argv[])
+try {
+    if (argc != 3) {
+        usage_unreserve();
+        return 1;
+    }
+
+    std::string arg{argv[2]};
+    if (arg == "-h" || arg == "--help") {
+        usage_unreserve();
+        return 0;
+    }
+
+    ControlData cd;
+    std::memset(&cd, 0, sizeof(cd));
+
+    cd.op = ControlData::Operations::UNRESERVE;
+    std::strncpy(cd.reserve_data.job, arg.c_str(), sizeof(cd.reserve_data.job) - 1);
+
+    /* Connect to the server and transmit the data */
+    auto conn = std::make_unique<Connection>(CONTROL_SOCKET);
+
+    conn->write(cd);
+    print_reply(*conn);
+
+    return 0;
+} catch (std::runtime_error& e) {
+    std::cout << "Something went wrong: " << e.what() << std::endl;
+    return 1;
+}
+
+void usage_reservations()
+{
+    std::cout << "usage: tetrisctl reservations [-h]" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "   -h, --help           show this help message" << std::endl;
+}
+
+int op_reservations(int argc, char* argv[])
+try {
+    if (argc > 3) {
+        usage_reservations();
+        return 1;
+    } else if (argc == 3) {
+        std::string arg{argv[2]};
+
+        if (arg == "-h" || arg == "--help") {
+            usage_reservations();
+            return 0;
+        } else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            usage_reservations();
+            return 1;
+        }
+    }
+
+    /* Connect to the server and ask for the reservations */
+    auto conn = std::make_unique<Connection>(CONTROL_SOCKET);
+    ControlData cd;
+
+    cd.op = ControlData::Operations::RESERVATIONS;
+
+    conn->write(cd);
+    print_reply(*conn);
 
     return 0;
 } catch (std::runtime_error& e) {
@@ -289,7 +587,12 @@ void usage()
         << "Operations:" << std::endl
         << "   upd_client           update a client's properties" << std::endl
         << "   upd_mappings         update the server's mapping database" << std::endl
-        << "   block_cpus           block the given CPUs from using" << std::endl;
+        << "   block_cpus           block the given CPUs from using" << std::endl
+        << "   stats                show the server's statistics" << std::endl
+        << "   energy_budget        set or show the system-wide energy budget" << std::endl
+        << "   reserve              reserve CPUs for a job" << std::endl
+        << "   unreserve            release the reservation of a job" << std::endl
+        << "   reservations         show the reservations" << std::endl;
 }
 
 int main(int argc, char* argv[])
@@ -310,6 +613,16 @@ int main(int argc, char* argv[])
         return op_update_mappings(argc, argv);
     } else if (op == "block_cpus") {
         return op_block_cpus(argc, argv);
+    } else if (op == "stats") {
+        return op_stats(argc, argv);
+    } else if (op == "energy_budget") {
+        return op_energy_budget(argc, argv);
+    } else if (op == "reserve") {
+        return op_reserve(argc, argv);
+    } else if (op == "unreserve") {
+        return op_unreserve(argc, argv);
+    } else if (op == "reservations") {
+        return op_reservations(argc, argv);
     } else {
         std::cout << "Unknown operation: " << op << std::endl;
         usage();
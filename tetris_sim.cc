@@ -0,0 +1,454 @@
+#include "config.h"
+#include "connection.h"
+#include "debug_util.h"
+#include "journal.h"
+#include "manager.h"
+#include "path_util.h"
+#include "platform.h"
+#include "policy.h"
+#include "server_config.h"
+#include "string_util.h"
+#include "tetris.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+
+/***
+ * Global variables
+ ***/
+
+debug::LoggerPtr logger;
+PlatformPtr platform;
+
+
+/***
+ * Simulated platform
+ ***/
+
+/* A virtual clock and an affinity backend which only counts what it is asked to do. */
+class SimPlatform : public Platform
+{
+   private:
+    Clock::time_point   _now;
+
+   public:
+    unsigned long       affinity_changes;
+    unsigned long       signals;
+
+    SimPlatform() :
+        _now{}, affinity_changes{0}, signals{0}
+    {}
+
+    Clock::time_point now() const override
+    {
+        return _now;
+    }
+
+    void set_now(Clock::time_point now)
+    {
+        _now = now;
+    }
+
+    bool set_affinity(int, const CPUList&) override
+    {
+        ++affinity_changes;
+        return true;
+    }
+
+    bool send_signal(int, int) override
+    {
+        ++signals;
+        return true;
+    }
+
+    std::vector<int> tasks(int pid) override
+    {
+        return {pid};
+    }
+
+    /* The journal doesn't know who ran the clients. */
+    bool peer(int, int&, int&) override
+    {
+        return false;
+    }
+
+    std::string cgroup(int) override
+    {
+        return "";
+    }
+};
+
+
+/***
+ * Replay of a journal
+ ***/
+
+class Replay
+{
+   private:
+    /* The server's end and the client's end of a simulated connection. The server's end is
+     * kept, so that its fd isn't reused while the journal still refers to the client. */
+    struct SimClient
+    {
+        int             fd;
+        ConnectionPtr   conn;
+        Connection      peer;
+    };
+
+    Manager&                    _manager;
+    std::shared_ptr<SimPlatform> _platform;
+    std::string                 _policy;
+    Clock::time_point           _start;
+
+    std::map<int, SimClient>    _clients;
+
+    /* Results */
+    unsigned long               _events;
+    unsigned long               _new_clients;
+    unsigned long               _unmanaged;
+    unsigned long               _decisions;
+    double                      _decision_s;
+    double                      _max_decision_s;
+    double                      _busy_cpu_s;
+    double                      _duration_s;
+    unsigned long               _finished;
+    std::map<std::string, double> _characteristics;
+    double                      _slowdown;
+
+    /* Throw away everything the manager sent to the client. */
+    static void drain(Connection& peer)
+    {
+        char buffer[4096];
+        while (::read(peer.fd(), buffer, sizeof(buffer)) > 0);
+    }
+
+    static std::pair<ConnectionPtr, Connection> connection_pair()
+    {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+            throw std::runtime_error{"Failed to create socket pair"};
+
+        ConnectionPtr conn = std::make_shared<Connection>(sv[0], sockaddr_un{});
+        conn->non_blocking();
+
+        Connection peer{sv[1], sockaddr_un{}};
+        peer.non_blocking();
+
+        return {conn, std::move(peer)};
+    }
+
+    int busy_cpus() const
+    {
+        CPUList busy;
+        for (const auto& [jfd, sc] : _clients) {
+            auto cl = _manager.client(sc.fd);
+            if (cl != nullptr && cl->state == Client::State::RUNNING)
+                busy |= cl->cpus();
+        }
+
+        return busy.nr_cpus();
+    }
+
+    void set_time(Clock::time_point t)
+    {
+        double dt = std::chrono::duration<double>(t - _platform->now()).count();
+        if (dt <= 0)
+            return;
+
+        _busy_cpu_s += dt * busy_cpus();
+        _duration_s += dt;
+        _platform->set_now(t);
+    }
+
+    /* Run all timed events of the manager which are due until t. */
+    void advance(Clock::time_point t)
+    {
+        while (true) {
+            int ms = _manager.timeout();
+            if (ms < 0)
+                break;
+
+            auto due = _platform->now() + std::chrono::milliseconds(std::max(ms, 1));
+            if (due > t)
+                break;
+
+            set_time(due);
+            _manager.tick();
+        }
+
+        set_time(t);
+
+        /* What is due right now happened before the event at t, like the release of a batch. */
+        if (_manager.timeout() == 0)
+            _manager.tick();
+    }
+
+    /* Account the predicted characteristics of a client which leaves. */
+    void finish(const SimClient& sc)
+    {
+        auto cl = _manager.client(sc.fd);
+        if (cl == nullptr || cl->state != Client::State::RUNNING)
+            return;
+
+        ++_finished;
+        for (const auto& [name, value] : cl->active_mapping.characteristics_map)
+            _characteristics[name] += value;
+        _slowdown += cl->slowdown;
+    }
+
+    /* Clients which the manager gave up on by itself run unmanaged, as they did when the
+     * journal was recorded. Their disconnect in the journal has nothing left to do. */
+    void forget_released()
+    {
+        for (auto it = _clients.begin(); it != _clients.end();) {
+            if (_manager.client(it->second.fd) == nullptr) {
+                ++_unmanaged;
+                it = _clients.erase(it);
+            } else
+                ++it;
+        }
+    }
+
+    void disconnect(int jfd)
+    {
+        auto it = _clients.find(jfd);
+        if (it == _clients.end())
+            return;
+
+        finish(it->second);
+        _manager.client_disconnect(it->second.fd);
+        _clients.erase(it);
+    }
+
+    void message(int jfd, const TetrisData& message)
+    {
+        auto it = _clients.find(jfd);
+        if (it == _clients.end()) {
+            logger->warning("Message for unknown client %d in journal\n", jfd);
+            return;
+        }
+
+        SimClient& sc = it->second;
+        sc.peer.write(message);
+
+        auto start = Clock::now();
+        bool close = _manager.client_message(sc.fd);
+        double d = elapsed_since(start);
+
+        if (message.op == TetrisData::NEW_CLIENT) {
+            ++_new_clients;
+            ++_decisions;
+            _decision_s += d;
+            _max_decision_s = std::max(_max_decision_s, d);
+
+            if (close)
+                ++_unmanaged;
+        }
+
+        drain(sc.peer);
+
+        if (close)
+            disconnect(jfd);
+    }
+
+    void control(ControlData data)
+    {
+        /* Clients are known by their connection, which differs between the runs. */
+        if (data.op == ControlData::Operations::UPDATE_CLIENT) {
+            auto it = _clients.find(data.update_data.client_fd);
+            data.update_data.client_fd = it == _clients.end() ? -1 : it->second.fd;
+        }
+
+        auto [conn, peer] = connection_pair();
+        _manager.control_message(data, *conn);
+        drain(peer);
+    }
+
+   public:
+    Replay(Manager& manager, const std::shared_ptr<SimPlatform>& platform, const std::string& policy) :
+        _manager{manager}, _platform{platform}, _policy{policy}, _start{platform->now()}, _clients{},
+        _events{0}, _new_clients{0}, _unmanaged{0}, _decisions{0}, _decision_s{0}, _max_decision_s{0},
+        _busy_cpu_s{0}, _duration_s{0}, _finished{0}, _characteristics{}, _slowdown{0}
+    {}
+
+    void run(JournalReader& reader)
+    {
+        Journal::Record r;
+        TetrisData message;
+        ControlData control;
+
+        while (reader.next(r, message, control)) {
+            ++_events;
+            advance(_start + std::chrono::nanoseconds(r.time_ns));
+            forget_released();
+
+            switch (r.event) {
+                case Journal::Event::CONNECT: {
+                    disconnect(r.fd);
+
+                    auto [conn, peer] = connection_pair();
+                    int fd = conn->fd();
+                    _clients.emplace(r.fd, SimClient{fd, conn, std::move(peer)});
+                    _manager.client_connect(fd, conn);
+                    break;
+                }
+                case Journal::Event::MESSAGE:
+                    this->message(r.fd, message);
+                    break;
+                case Journal::Event::DISCONNECT:
+                    disconnect(r.fd);
+                    break;
+                case Journal::Event::CONTROL:
+                    this->control(control);
+                    break;
+                case Journal::Event::RELOAD:
+                    _manager.update_mappings();
+                    break;
+                default:
+                    throw std::runtime_error{"Unknown journal event " + std::to_string(static_cast<uint32_t>(r.event))};
+            }
+
+            _manager.tick();
+            forget_released();
+        }
+
+        /* Clients still running at the end of the journal count as well. */
+        for (const auto& [jfd, sc] : _clients)
+            finish(sc);
+    }
+
+    void print(std::ostream& os) const
+    {
+        os << std::fixed << std::setprecision(3);
+        os << "Simulation results:" << std::endl
+           << "===================" << std::endl
+           << "-> policy: " << _policy << std::endl
+           << "-> events: " << _events << " (simulated time: " << _duration_s << " s)" << std::endl
+           << "-> clients: " << _new_clients << " (unmanaged: " << _unmanaged << ")" << std::endl
+           << "-> decision latency: avg " << (_decisions != 0 ? 1e6 * _decision_s / _decisions : 0.0)
+           << " us, max " << 1e6 * _max_decision_s << " us" << std::endl
+           << "-> packing efficiency: " << (_duration_s > 0 ? 100 * _busy_cpu_s / (_duration_s * num_cpus) : 0.0)
+           << "% of the cpu time" << std::endl
+           << "-> affinity changes: " << _platform->affinity_changes << ", signals: " << _platform->signals << std::endl
+           << "-> expected slowdown by co-located clients: avg " << (_finished != 0 ? _slowdown / _finished : 1.0) << std::endl
+           << "-> predicted characteristics (sum over " << _finished << " clients):" << std::endl;
+        for (const auto& [name, value] : _characteristics)
+            os << "--> " << name << ": " << value << std::endl;
+        os << "===== END OF SIMULATION ====" << std::endl;
+    }
+};
+
+
+void usage()
+{
+    std::cout << "usage: tetrissim [-h] [OPTIONS] MAPPINGS JOURNAL" << std::endl
+        << std::endl
+        << "Replays a journal recorded with 'tetrisserver --journal' against the manager." << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "   -h, --help           show this help message." << std::endl
+        << "   --stats              also print the manager's statistics." << std::endl
+        << "   --policy FILE        may be given several times to compare placement policies on the journal." << std::endl;
+    server_options_usage(std::cout);
+    std::cout << std::endl
+        << "Positionals:" << std::endl
+        << " MAPPINGS               path the folder with the per-app mappings." << std::endl
+        << " JOURNAL                the journal to replay." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    /* Parsing command line arguments. */
+    std::string mappings_path;
+    std::string journal_path;
+    bool print_stats = false;
+    ServerConfig config;
+    std::vector<std::string> policies;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (arg == "--stats") {
+            print_stats = true;
+            continue;
+        }
+
+        auto state = parse_server_option(argc, argv, i, config);
+        if (state == OptionState::OK) {
+            /* Each policy replays the journal on its own. */
+            if (arg == "--policy")
+                policies.push_back(config.policy);
+            continue;
+        } else if (state == OptionState::INVALID) {
+            usage();
+            return 1;
+        } else if (string_util::starts_with(arg, "-") || !journal_path.empty()) {
+            std::cout << "Unknown option: " << arg << std::endl;
+            usage();
+            return 1;
+        } else if (mappings_path.empty()) {
+            mappings_path = path_util::abspath(path_util::expanduser(arg));
+        } else {
+            journal_path = path_util::abspath(path_util::expanduser(arg));
+        }
+    }
+
+    if (journal_path.empty()) {
+        usage();
+        return 1;
+    }
+
+    /* Nothing is parked on the simulated machine, and a replay must neither touch the state
+     * of the running server nor record a journal of its own. Its draws are repeatable. */
+    config.park_cpus = false;
+    config.explore_state_path.clear();
+    config.journal_path.clear();
+    if (config.explore_seed < 0)
+        config.explore_seed = 0;
+
+    logger = debug::Logger::get();
+
+    if (policies.empty())
+        policies.push_back(config.policy);
+
+    /* Every policy replays the journal on a fresh manager. */
+    for (const auto& p : policies) {
+        auto sim = std::make_shared<SimPlatform>();
+        platform = sim;
+
+        try {
+            JournalReader reader{journal_path};
+
+            auto policy = load_policy(p, config.policy_args);
+
+            Manager manager{mappings_path, config, policy};
+            Replay replay{manager, sim, policy->name()};
+
+            replay.run(reader);
+
+            replay.print(std::cout);
+            if (print_stats)
+                manager.print_stats(std::cout);
+        } catch (std::runtime_error& e) {
+            std::cerr << "Simulation failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
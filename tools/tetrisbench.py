@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+
+# Runs a number of copies of a program at the same time against a TETRiS server and
+# reports how fast they get through. Every server configuration is benchmarked with a
+# fresh server, e.g. the unmanaged fallback against time slicing:
+#
+#   tetrisbench.py -n 6 -c "" -c "--timeslice 0.1" -- ./jpeg_encoder input.ppm
+
+import sys,os,time,signal,shlex,subprocess,argparse
+
+
+root = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+def runRound(cmd, n, stagger):
+	env = dict(os.environ)
+	env["LD_PRELOAD"] = os.path.join(root, "lib", "libtetrisclient.so")
+
+	start = time.monotonic()
+	procs = []
+	for i in range(n):
+		procs.append((subprocess.Popen(cmd, env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL), time.monotonic()))
+		time.sleep(stagger)
+
+	turnaround = []
+	failed = 0
+	for (p,t) in procs:
+		if p.wait() != 0:
+			failed += 1
+		turnaround.append(time.monotonic() - t)
+
+	return (time.monotonic() - start, turnaround, failed)
+
+def runConfig(args, config):
+	sock = "/tmp/tetris_socket"
+	server = subprocess.Popen([os.path.join(root, "bin", "tetrisserver")] + shlex.split(config) + [args.mappings],
+			stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+	for i in range(50):
+		if os.path.exists(sock): break
+		time.sleep(0.1)
+	else:
+		server.kill()
+		print("Server didn't come up with: "+config, file=sys.stderr)
+		sys.exit(-1)
+
+	makespans = []
+	turnarounds = []
+	failed = 0
+	try:
+		for r in range(args.rounds):
+			(makespan, turnaround, f) = runRound(args.command, args.clients, args.stagger)
+			makespans.append(makespan)
+			turnarounds += turnaround
+			failed += f
+	finally:
+		server.send_signal(signal.SIGTERM)
+		server.wait()
+
+	jobs = args.clients * args.rounds
+	return (sum(makespans) / len(makespans), sum(turnarounds) / len(turnarounds), jobs / sum(makespans), failed)
+
+parser = argparse.ArgumentParser(description="Benchmark the throughput of simultaneously started clients.")
+parser.add_argument("-n", "--clients", type=int, default=8, help="copies started per round (default: 8)")
+parser.add_argument("-r", "--rounds", type=int, default=3, help="rounds per configuration (default: 3)")
+parser.add_argument("-s", "--stagger", type=float, default=0.05, help="seconds between two starts (default: 0.05)")
+parser.add_argument("-c", "--config", action="append", help="server options of one configuration (default: '' and '--timeslice 0.1')")
+parser.add_argument("-m", "--mappings", default=os.path.join(root, "mappings"), help="mapping database of the server")
+parser.add_argument("command", nargs=argparse.REMAINDER, help="the program to run")
+args = parser.parse_args()
+
+if args.command and args.command[0] == "--":
+	args.command = args.command[1:]
+if not args.command:
+	parser.print_usage()
+	sys.exit(-1)
+
+configs = args.config if args.config else ["", "--timeslice 0.1"]
+
+print("%-30s %12s %14s %12s %8s" % ("configuration", "makespan[s]", "turnaround[s]", "jobs/s", "failed"))
+for config in configs:
+	(makespan, turnaround, throughput, failed) = runConfig(args, config)
+	print("%-30s %12.3f %14.3f %12.3f %8d" % (config if config else "(unmanaged fallback)", makespan, turnaround, throughput, failed))